@@ -290,6 +290,11 @@ if [[ $USE_OPENMP -eq 1 ]]; then
     make -C openmp -j$THREADS
 fi
 
+if [[ $USE_NATIVE -eq 1 ]]; then
+    make -C native clean
+    make -C native -j$THREADS
+fi
+
 if [[ $USE_OMPSS -eq 1 ]]; then
     pushd "$NANOS_SRC_DIR"
     if [[ ! -d build ]]; then
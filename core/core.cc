@@ -33,8 +33,20 @@
 #include "core_random.h"
 #include "custom_taskinfo.h"
 
+#if (__AVX2__ == 1) || (__AVX__ == 1)
+#include <immintrin.h>
+#endif
+
 #define USER_DEFINED_DEBUG
 
+// The dispatch helpers below are forced inline so that TaskGraph::bind()
+// gets one fully specialized copy per dependence and kernel type.
+#ifdef __GNUC__
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
 #ifdef DEBUG_CORE
 typedef unsigned long long TaskGraphMask;
 static std::atomic<TaskGraphMask> has_executed_graph;
@@ -61,16 +73,16 @@ using DependenceMapType = std::unordered_map<DependenceKeyType, DependenceResult
 
 void TaskGraph::set_task_info(std::string task_info_file) {
   task_info = new CustomTaskInfo(task_info_file);
-  nb_fields = task_info->get_timestamp();
-  timesteps = nb_fields;
+  timesteps = task_info->get_timestamp();
   max_width = task_info->get_max_width();
+  nb_fields = min_nb_fields();
 }
 
 void TaskGraph::set_task_info(CustomTaskInfo *task_info) {
   this->task_info = task_info;
-  nb_fields = task_info->get_timestamp();
-  timesteps = nb_fields;
+  timesteps = task_info->get_timestamp();
   max_width = task_info->get_max_width();
+  nb_fields = min_nb_fields();
 }
 
 CustomTaskInfo* TaskGraph::get_task_info() const {
@@ -180,52 +192,59 @@ void GPUKernel::execute(long graph_index, long timestep, long point,
   }                     
 }
 
-void Kernel::execute(long graph_index, long timestep, long point,
-                     char *scratch_ptr, size_t scratch_bytes, double expect_time) const
+// Body of Kernel::execute, forced inline into the bound fast paths.
+static ALWAYS_INLINE void execute_kernel(const Kernel &k, long graph_index, long timestep, long point,
+                                         char *scratch_ptr, size_t scratch_bytes, double expect_time)
 {
-  switch(type) {
+  switch(k.type) {
   case KernelType::EMPTY:
-    execute_kernel_empty(*this);
+    execute_kernel_empty(k);
     break;
   case KernelType::BUSY_WAIT:
-    execute_kernel_busy_wait(*this);
+    execute_kernel_busy_wait(k);
     break;
   case KernelType::MEMORY_BOUND:
     assert(scratch_ptr != NULL);
     assert(scratch_bytes > 0);
-    execute_kernel_memory(*this, scratch_ptr, scratch_bytes, timestep);
+    execute_kernel_memory(k, scratch_ptr, scratch_bytes, timestep);
     break;
   case KernelType::COMPUTE_DGEMM:
     assert(scratch_ptr != NULL);
     assert(scratch_bytes > 0);
-    execute_kernel_dgemm(*this, scratch_ptr, scratch_bytes);
+    execute_kernel_dgemm(k, scratch_ptr, scratch_bytes);
     break;
   case KernelType::MEMORY_DAXPY:
     assert(scratch_ptr != NULL);
     assert(scratch_bytes > 0);
-    execute_kernel_daxpy(*this, scratch_ptr, scratch_bytes, timestep);
+    execute_kernel_daxpy(k, scratch_ptr, scratch_bytes, timestep);
     break;  
   case KernelType::COMPUTE_BOUND:
-    execute_kernel_compute(*this);
+    execute_kernel_compute(k);
     break;
   case KernelType::COMPUTE_BOUND2:
-    execute_kernel_compute2(*this);
+    execute_kernel_compute2(k);
     break;
   case KernelType::IO_BOUND:
-    execute_kernel_io(*this);
+    execute_kernel_io(k);
     break;
   case KernelType::LOAD_IMBALANCE:
     assert(timestep >= 0 && point >= 0);
-    execute_kernel_imbalance(*this, graph_index, timestep, point);
+    execute_kernel_imbalance(k, graph_index, timestep, point);
     break;
   case KernelType::CUSTOMIZE:
-    execute_kernel_customize(*this, expect_time);
+    execute_kernel_customize(k, expect_time);
     break;
   default:
     assert(false && "unimplemented kernel type");
   };
 }
 
+void Kernel::execute(long graph_index, long timestep, long point,
+                     char *scratch_ptr, size_t scratch_bytes, double expect_time) const
+{
+  execute_kernel(*this, graph_index, timestep, point, scratch_ptr, scratch_bytes, expect_time);
+}
+
 static const std::map<std::string, KernelType> ktype_by_name = {
   {"empty", KernelType::EMPTY},
   {"busy_wait", KernelType::BUSY_WAIT},
@@ -255,6 +274,92 @@ static std::map<KernelType, std::string> make_name_by_ktype()
 
 static const std::map<KernelType, std::string> name_by_ktype = make_name_by_ktype();
 
+static const std::map<std::string, OutputDistribution> odist_by_name = {
+  {"constant", OutputDistribution::OUTPUT_CONSTANT},
+  {"uniform", OutputDistribution::OUTPUT_UNIFORM},
+  {"loguniform", OutputDistribution::OUTPUT_LOGUNIFORM},
+};
+
+static std::map<OutputDistribution, std::string> make_name_by_odist()
+{
+  std::map<OutputDistribution, std::string> names;
+
+  for (auto pair : odist_by_name) {
+    names[pair.second] = pair.first;
+  }
+
+  return names;
+}
+
+static const std::map<OutputDistribution, std::string> name_by_odist = make_name_by_odist();
+
+static const std::map<std::string, ValidationLevel> validation_by_name = {
+  {"full", ValidationLevel::VALIDATE_FULL},
+  {"sampled", ValidationLevel::VALIDATE_SAMPLED},
+  {"checksum", ValidationLevel::VALIDATE_CHECKSUM},
+  {"none", ValidationLevel::VALIDATE_NONE},
+};
+
+static std::map<ValidationLevel, std::string> make_name_by_validation()
+{
+  std::map<ValidationLevel, std::string> names;
+
+  for (auto pair : validation_by_name) {
+    names[pair.second] = pair.first;
+  }
+
+  return names;
+}
+
+static const std::map<ValidationLevel, std::string> name_by_validation = make_name_by_validation();
+
+static const std::map<std::string, alloc_placement_t> placement_by_name = {
+  {"default", ALLOC_DEFAULT},
+  {"first-touch", ALLOC_FIRST_TOUCH},
+  {"interleave", ALLOC_INTERLEAVED},
+  {"node", ALLOC_NODE_BOUND},
+};
+
+static const std::map<std::string, alloc_pages_t> pages_by_name = {
+  {"none", PAGES_DEFAULT},
+  {"transparent", PAGES_TRANSPARENT_HUGE},
+  {"explicit", PAGES_EXPLICIT_HUGE},
+};
+
+static const std::map<std::string, SubmissionPolicy> submission_by_name = {
+  {"sequential", SUBMIT_SEQUENTIAL},
+  {"round-robin", SUBMIT_ROUND_ROBIN},
+  {"weighted", SUBMIT_WEIGHTED},
+};
+
+static const std::map<std::string, ScratchPolicy> scratch_policy_by_name = {
+  {"worker", SCRATCH_PER_WORKER},
+  {"ring", SCRATCH_WORKER_RING},
+  {"point", SCRATCH_PER_POINT},
+  {"task", SCRATCH_PER_TASK},
+};
+
+static const std::map<std::string, ImbalanceDistribution> idist_by_name = {
+  {"uniform", ImbalanceDistribution::IMBALANCE_UNIFORM},
+  {"normal", ImbalanceDistribution::IMBALANCE_NORMAL},
+  {"lognormal", ImbalanceDistribution::IMBALANCE_LOGNORMAL},
+  {"bimodal", ImbalanceDistribution::IMBALANCE_BIMODAL},
+  {"pareto", ImbalanceDistribution::IMBALANCE_PARETO},
+};
+
+static std::map<ImbalanceDistribution, std::string> make_name_by_idist()
+{
+  std::map<ImbalanceDistribution, std::string> names;
+
+  for (auto pair : idist_by_name) {
+    names[pair.second] = pair.first;
+  }
+
+  return names;
+}
+
+static const std::map<ImbalanceDistribution, std::string> name_by_idist = make_name_by_idist();
+
 static const std::map<std::string, DependenceType> dtype_by_name = {
   {"trivial", DependenceType::TRIVIAL},
   {"no_comm", DependenceType::NO_COMM},
@@ -289,12 +394,17 @@ static std::map<DependenceType, std::string> make_name_by_dtype()
 static std::map<DependenceType, std::string> name_by_dtype = make_name_by_dtype();
 
 long TaskGraph::offset_at_timestep(long timestep) const
+{
+  return offset_at_timestep(timestep, dependence);
+}
+
+ALWAYS_INLINE long TaskGraph::offset_at_timestep(long timestep, DependenceType dtype) const
 {
   if (timestep < 0) {
     return 0;
   }
 
-  switch (dependence) {
+  switch (dtype) {
   case DependenceType::TRIVIAL:
   case DependenceType::NO_COMM:
   case DependenceType::STENCIL_1D:
@@ -323,12 +433,17 @@ static long getWidthOfCholeskyLikeRandom(long timestep) {
 }
 
 long TaskGraph::width_at_timestep(long timestep) const
+{
+  return width_at_timestep(timestep, dependence);
+}
+
+ALWAYS_INLINE long TaskGraph::width_at_timestep(long timestep, DependenceType dtype) const
 {
   if (timestep < 0) {
     return 0;
   }
 
-  switch (dependence) {
+  switch (dtype) {
   case DependenceType::TRIVIAL:
   case DependenceType::NO_COMM:
   case DependenceType::STENCIL_1D:
@@ -357,7 +472,12 @@ long TaskGraph::width_at_timestep(long timestep) const
 
 long TaskGraph::max_dependence_sets() const
 {
-  switch (dependence) {
+  return max_dependence_sets(dependence);
+}
+
+ALWAYS_INLINE long TaskGraph::max_dependence_sets(DependenceType dtype) const
+{
+  switch (dtype) {
   case DependenceType::TRIVIAL:
   case DependenceType::NO_COMM:
   case DependenceType::STENCIL_1D:
@@ -390,7 +510,12 @@ long TaskGraph::timestep_period() const
 
 long TaskGraph::dependence_set_at_timestep(long timestep) const
 {
-  switch (dependence) {
+  return dependence_set_at_timestep(timestep, dependence);
+}
+
+ALWAYS_INLINE long TaskGraph::dependence_set_at_timestep(long timestep, DependenceType dtype) const
+{
+  switch (dtype) {
   case DependenceType::TRIVIAL:
   case DependenceType::NO_COMM:
   case DependenceType::STENCIL_1D:
@@ -399,14 +524,14 @@ long TaskGraph::dependence_set_at_timestep(long timestep) const
   case DependenceType::TREE:
     return 0;
   case DependenceType::FFT:
-    return (timestep + max_dependence_sets() - 1) % max_dependence_sets();
+    return (timestep + max_dependence_sets(dtype) - 1) % max_dependence_sets(dtype);
   case DependenceType::ALL_TO_ALL:
   case DependenceType::NEAREST:
     return 0;
   case DependenceType::SPREAD:
   case DependenceType::RANDOM_NEAREST:
   case DependenceType::RANDOM_SPREAD:
-    return timestep % max_dependence_sets();
+    return timestep % max_dependence_sets(dtype);
   case DependenceType::CHOLESKY_LIKE_RANDOM:
   case DependenceType::USER_DEFINED:
     return 0;
@@ -415,6 +540,46 @@ long TaskGraph::dependence_set_at_timestep(long timestep) const
   };
 }
 
+size_t TaskGraph::output_bytes_at_point(long timestep, long point) const
+{
+  if (dependence == DependenceType::USER_DEFINED &&
+      task_info != nullptr && task_info->taskOutputBytesInitialized()) {
+    size_t bytes = task_info->getTaskOutputBytesAtPoint(timestep, point);
+    if (bytes > 0) {
+      bytes = std::max(bytes, sizeof(std::pair<long, long>));
+      return std::min(bytes, output_bytes_per_task);
+    }
+    // Types without an entry use -output.
+    return output_bytes_per_task;
+  }
+
+  if (output_distribution == OutputDistribution::OUTPUT_CONSTANT) {
+    return output_bytes_per_task;
+  }
+
+  const long seed[4] = {graph_index, timestep, point, 2};
+  double value = random_uniform(&seed[0], sizeof(seed));
+
+  double min_bytes = min_output_bytes_per_task;
+  double max_bytes = output_bytes_per_task;
+  double bytes = 0;
+  switch (output_distribution) {
+  case OutputDistribution::OUTPUT_UNIFORM:
+    bytes = min_bytes + value * (max_bytes - min_bytes);
+    break;
+  case OutputDistribution::OUTPUT_LOGUNIFORM:
+    bytes = min_bytes * pow(max_bytes / min_bytes, value);
+    break;
+  default:
+    assert(false && "unexpected output distribution");
+  };
+
+  // Outputs are made of whole (timestep, point) pairs.
+  size_t elements = (size_t)bytes / sizeof(std::pair<long, long>);
+  elements = std::max(elements, (size_t)1);
+  return std::min(elements * sizeof(std::pair<long, long>), output_bytes_per_task);
+}
+
 std::vector<std::pair<long, long> > TaskGraph::reverse_dependencies(long dset, long point) const
 {
   size_t count = num_reverse_dependencies(dset, point);
@@ -605,6 +770,29 @@ size_t TaskGraph::random_dependencies(long dset, long point, std::pair<long, lon
   return idx;
 }
 
+long TaskGraph::min_nb_fields() const
+{
+  if (dependence != DependenceType::USER_DEFINED) {
+    // Built-in patterns only read timestep t-1.
+    return std::min(timesteps, 2L);
+  }
+  if (task_info == nullptr) {
+    // Dependencies are not known until set_task_info.
+    return timesteps;
+  }
+
+  long max_lag = 1;
+  for (long t = 1; t < timesteps; t++) {
+    long width = getUserDefineWidthAtTimestep(t);
+    for (long p = 0; p < width; p++) {
+      for (auto &dep : user_defined_dependencies(t, p)) {
+        max_lag = std::max(max_lag, t - dep.first);
+      }
+    }
+  }
+  return std::min(timesteps, max_lag + 1);
+}
+
 std::vector<std::pair<long, long> > TaskGraph::user_defined_dependencies(int time, long point) const {
   assert (dependence == DependenceType::USER_DEFINED && task_info != nullptr);
   if (time == 0) {
@@ -625,7 +813,12 @@ std::vector<std::pair<long, long> > TaskGraph::dependencies(long dset, long poin
 
 size_t TaskGraph::dependencies(long dset, long point, std::pair<long, long> *deps) const
 {
-  switch (dependence) {
+  return dependencies(dset, point, deps, dependence);
+}
+
+ALWAYS_INLINE size_t TaskGraph::dependencies(long dset, long point, std::pair<long, long> *deps, DependenceType dtype) const
+{
+  switch (dtype) {
   case DependenceType::TRIVIAL:
     return 0;
   case DependenceType::NO_COMM:
@@ -727,7 +920,12 @@ size_t TaskGraph::dependencies(long dset, long point, std::pair<long, long> *dep
 
 size_t TaskGraph::num_dependencies(long dset, long point) const
 {
-  switch (dependence) {
+  return num_dependencies(dset, point, dependence);
+}
+
+ALWAYS_INLINE size_t TaskGraph::num_dependencies(long dset, long point, DependenceType dtype) const
+{
+  switch (dtype) {
   case DependenceType::TRIVIAL:
     return 0;
   case DependenceType::NO_COMM:
@@ -760,11 +958,135 @@ size_t TaskGraph::num_dependencies(long dset, long point) const
 
 #define MAGIC_VALUE UINT64_C(0x5C4A7C8B) // can you read it? it says "SCRATCHB" (kinda)
 
-void TaskGraph::execute_point(long timestep, long point,
-                              char *output_ptr, size_t output_bytes,
-                              const char **input_ptr, const size_t *input_bytes,
-                              size_t n_inputs,
-                              char *scratch_ptr, size_t scratch_bytes) const
+static void fill_output(char *output_ptr, size_t output_bytes, long timestep, long point)
+{
+  std::pair<long, long> *output = reinterpret_cast<std::pair<long, long> *>(output_ptr);
+  size_t n = output_bytes/sizeof(std::pair<long, long>);
+  size_t i = 0;
+#if ((__AVX2__ == 1) || (__AVX__ == 1)) && defined(__LP64__)
+  // Two pairs per store
+  __m256i value = _mm256_set_epi64x(point, timestep, point, timestep);
+  for (; i + 2 <= n; i += 2) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), value);
+  }
+#endif
+  for (; i < n; ++i) {
+    output[i].first = timestep;
+    output[i].second = point;
+  }
+}
+
+static inline void check_input_pair(const TaskGraph &g, long timestep, long point, size_t idx,
+                                    const std::pair<long, long> *input, size_t i, long dep)
+{
+#ifdef DEBUG_CORE
+  if (input[i].first != timestep - 1 || input[i].second != dep) {
+    printf("ERROR: Task Bench detected corrupted value in task (graph %ld timestep %ld point %ld) input %ld\n  At position %lu within the buffer, expected value (timestep %ld point %ld) but got (timestep %ld point %ld)\n",
+           g.graph_index, timestep, point, idx,
+           i, timestep - 1, dep, input[i].first, input[i].second);
+    fflush(stdout);
+  }
+#endif
+  assert(input[i].first == timestep - 1);
+  assert(input[i].second == dep);
+}
+
+static void validate_input(const TaskGraph &g, long timestep, long point, size_t idx,
+                           const char *input_ptr, size_t dep_bytes, long dep)
+{
+  const std::pair<long, long> *input = reinterpret_cast<const std::pair<long, long> *>(input_ptr);
+  size_t n = dep_bytes/sizeof(std::pair<long, long>);
+  switch (g.validation) {
+  case ValidationLevel::VALIDATE_FULL:
+    for (size_t i = 0; i < n; ++i) {
+      check_input_pair(g, timestep, point, idx, input, i, dep);
+    }
+    break;
+  case ValidationLevel::VALIDATE_SAMPLED:
+    if (n <= (size_t)g.validation_samples + 2) {
+      // Sampling would touch at least as many pairs as a full scan.
+      for (size_t i = 0; i < n; ++i) {
+        check_input_pair(g, timestep, point, idx, input, i, dep);
+      }
+    } else {
+      check_input_pair(g, timestep, point, idx, input, 0, dep);
+      check_input_pair(g, timestep, point, idx, input, n - 1, dep);
+      // One hash per input picks a random phase; samples are spread
+      // evenly from there.
+      if (g.validation_samples > 0) {
+        long seed[4] = {g.graph_index, timestep, point, (long)idx};
+        size_t start = std::min(n - 1, (size_t)(random_uniform(&seed, sizeof(seed)) * n));
+        size_t stride = n / g.validation_samples;
+        for (long s = 0; s < g.validation_samples; ++s) {
+          check_input_pair(g, timestep, point, idx, input, (start + s * stride) % n, dep);
+        }
+      }
+    }
+    break;
+  case ValidationLevel::VALIDATE_CHECKSUM:
+    {
+      // Separate sums for the timestep and point lanes; unsigned so
+      // that overflow wraps, and simple enough for the compiler to
+      // vectorize.
+      const uint64_t *words = reinterpret_cast<const uint64_t *>(input_ptr);
+      uint64_t sum_first = 0, sum_second = 0;
+      for (size_t i = 0; i < 2*n; i += 2) {
+        sum_first += words[i];
+        sum_second += words[i+1];
+      }
+      if (sum_first != (uint64_t)(timestep - 1) * n || sum_second != (uint64_t)dep * n) {
+        // Fall back to a full scan to report the first bad position.
+        for (size_t i = 0; i < n; ++i) {
+          check_input_pair(g, timestep, point, idx, input, i, dep);
+        }
+        assert(false && "checksum mismatch");
+      }
+    }
+    break;
+  case ValidationLevel::VALIDATE_NONE:
+    break;
+  default:
+    assert(false && "unexpected validation level");
+  }
+}
+
+ALWAYS_INLINE void TaskGraph::validate_inputs(DependenceType dtype, long timestep, long point,
+                                              const char **input_ptr, const size_t *input_bytes,
+                                              size_t n_inputs) const
+{
+  long last_offset = offset_at_timestep(timestep-1, dtype);
+  long last_width = width_at_timestep(timestep-1, dtype);
+
+  size_t idx = 0;
+  long dset = dependence_set_at_timestep(timestep, dtype);
+  size_t max_deps = num_dependencies(dset, point, dtype);
+  std::pair<long, long> *deps = reinterpret_cast<std::pair<long, long> *>(alloca(sizeof(std::pair<long, long>) * max_deps));
+  size_t num_deps = dependencies(dset, point, deps, dtype);
+  for (size_t span = 0; span < num_deps; span++) {
+    for (long dep = deps[span].first; dep <= deps[span].second; dep++) {
+      if (last_offset <= dep && dep < last_offset + last_width) {
+        assert(idx < n_inputs);
+
+        size_t dep_bytes = output_bytes_at_point(timestep - 1, dep);
+        assert(input_bytes[idx] >= dep_bytes);
+        assert(input_bytes[idx] <= output_bytes_per_task);
+
+        validate_input(*this, timestep, point, idx, input_ptr[idx], dep_bytes, dep);
+        idx++;
+      }
+    }
+  }
+  // FIXME (Elliott): Legion is currently passing in uninitialized
+  // memory for dependencies outside of the last offset/width.
+  // assert(idx == n_inputs);
+}
+
+ALWAYS_INLINE void TaskGraph::execute_point(DependenceType dtype, KernelType ktype,
+                                            long timestep, long point,
+                                            char *output_ptr, size_t output_bytes,
+                                            const char **input_ptr, const size_t *input_bytes,
+                                            size_t n_inputs,
+                                            char *scratch_ptr, size_t scratch_bytes) const
 {
 #ifdef DEBUG_CORE
   // Validate graph_index
@@ -775,59 +1097,24 @@ void TaskGraph::execute_point(long timestep, long point,
   // Validate timestep and point
   assert(0 <= timestep && timestep < timesteps);
 
-  long offset = offset_at_timestep(timestep);
-  long width = width_at_timestep(timestep);
+  long offset = offset_at_timestep(timestep, dtype);
+  long width = width_at_timestep(timestep, dtype);
   assert(offset <= point && point < offset+width);
 
-  long last_offset = offset_at_timestep(timestep-1);
-  long last_width = width_at_timestep(timestep-1);
-
   // Validate input
-  {
-    size_t idx = 0;
-    long dset = dependence_set_at_timestep(timestep);
-    size_t max_deps = num_dependencies(dset, point);
-    std::pair<long, long> *deps = reinterpret_cast<std::pair<long, long> *>(alloca(sizeof(std::pair<long, long>) * max_deps));
-    size_t num_deps = dependencies(dset, point, deps);
-    for (size_t span = 0; span < num_deps; span++) {
-      for (long dep = deps[span].first; dep <= deps[span].second; dep++) {
-        if (last_offset <= dep && dep < last_offset + last_width) {
-          assert(idx < n_inputs);
-
-          assert(input_bytes[idx] == output_bytes_per_task);
-          assert(input_bytes[idx] >= sizeof(std::pair<long, long>));
-
-          const std::pair<long, long> *input = reinterpret_cast<const std::pair<long, long> *>(input_ptr[idx]);
-          for (size_t i = 0; i < input_bytes[idx]/sizeof(std::pair<long, long>); ++i) {
-#ifdef DEBUG_CORE
-            if (input[i].first != timestep - 1 || input[i].second != dep) {
-              printf("ERROR: Task Bench detected corrupted value in task (graph %ld timestep %ld point %ld) input %ld\n  At position %lu within the buffer, expected value (timestep %ld point %ld) but got (timestep %ld point %ld)\n",
-                     graph_index, timestep, point, idx,
-                     i, timestep - 1, dep, input[i].first, input[i].second);
-              fflush(stdout);
-            }
-#endif
-            assert(input[i].first == timestep - 1);
-            assert(input[i].second == dep);
-          }
-          idx++;
-        }
-      }
-    }
-    // FIXME (Elliott): Legion is currently passing in uninitialized
-    // memory for dependencies outside of the last offset/width.
-    // assert(idx == n_inputs);
+  if (validation != ValidationLevel::VALIDATE_NONE) {
+    validate_inputs(dtype, timestep, point, input_ptr, input_bytes, n_inputs);
   }
 
   // Validate output
-  assert(output_bytes == output_bytes_per_task);
-  assert(output_bytes >= sizeof(std::pair<long, long>));
+  size_t point_output_bytes = output_bytes_at_point(timestep, point);
+  assert(output_bytes >= point_output_bytes);
+  assert(output_bytes <= output_bytes_per_task);
+  assert(point_output_bytes >= sizeof(std::pair<long, long>));
 
   // Generate output
-  std::pair<long, long> *output = reinterpret_cast<std::pair<long, long> *>(output_ptr);
-  for (size_t i = 0; i < output_bytes/sizeof(std::pair<long, long>); ++i) {
-    output[i].first = timestep;
-    output[i].second = point;
+  if (validation != ValidationLevel::VALIDATE_NONE) {
+    fill_output(output_ptr, point_output_bytes, timestep, point);
   }
 
   // Validate scratch
@@ -839,7 +1126,124 @@ void TaskGraph::execute_point(long timestep, long point,
 
   // Execute kernel
   Kernel k(kernel);
-  k.execute(graph_index, timestep, point, scratch_ptr, scratch_bytes);
+  k.type = ktype;
+  execute_kernel(k, graph_index, timestep, point, scratch_ptr, scratch_bytes, 0);
+}
+
+void TaskGraph::execute_point(long timestep, long point,
+                              char *output_ptr, size_t output_bytes,
+                              const char **input_ptr, const size_t *input_bytes,
+                              size_t n_inputs,
+                              char *scratch_ptr, size_t scratch_bytes) const
+{
+  execute_point(dependence, kernel.type, timestep, point,
+                output_ptr, output_bytes, input_ptr, input_bytes, n_inputs,
+                scratch_ptr, scratch_bytes);
+}
+
+template<DependenceType D, KernelType K>
+void TaskGraph::execute_point_bound(const TaskGraph &graph, long timestep, long point,
+                                    char *output_ptr, size_t output_bytes,
+                                    const char **input_ptr, const size_t *input_bytes,
+                                    size_t n_inputs,
+                                    char *scratch_ptr, size_t scratch_bytes)
+{
+  graph.execute_point(D, K, timestep, point,
+                      output_ptr, output_bytes, input_ptr, input_bytes, n_inputs,
+                      scratch_ptr, scratch_bytes);
+}
+
+template<DependenceType D>
+ExecutePointFn TaskGraph::bind_kernel(KernelType ktype)
+{
+  switch (ktype) {
+  case KernelType::EMPTY:
+    return &TaskGraph::execute_point_bound<D, KernelType::EMPTY>;
+  case KernelType::BUSY_WAIT:
+    return &TaskGraph::execute_point_bound<D, KernelType::BUSY_WAIT>;
+  case KernelType::MEMORY_BOUND:
+    return &TaskGraph::execute_point_bound<D, KernelType::MEMORY_BOUND>;
+  case KernelType::COMPUTE_DGEMM:
+    return &TaskGraph::execute_point_bound<D, KernelType::COMPUTE_DGEMM>;
+  case KernelType::MEMORY_DAXPY:
+    return &TaskGraph::execute_point_bound<D, KernelType::MEMORY_DAXPY>;
+  case KernelType::COMPUTE_BOUND:
+    return &TaskGraph::execute_point_bound<D, KernelType::COMPUTE_BOUND>;
+  case KernelType::COMPUTE_BOUND2:
+    return &TaskGraph::execute_point_bound<D, KernelType::COMPUTE_BOUND2>;
+  case KernelType::IO_BOUND:
+    return &TaskGraph::execute_point_bound<D, KernelType::IO_BOUND>;
+  case KernelType::LOAD_IMBALANCE:
+    return &TaskGraph::execute_point_bound<D, KernelType::LOAD_IMBALANCE>;
+  case KernelType::CUSTOMIZE:
+    return &TaskGraph::execute_point_bound<D, KernelType::CUSTOMIZE>;
+  default:
+    assert(false && "unimplemented kernel type");
+  };
+  return NULL;
+}
+
+BoundTaskGraph TaskGraph::bind() const
+{
+  BoundTaskGraph bound;
+  bound.graph = this;
+  switch (dependence) {
+  case DependenceType::TRIVIAL:
+    bound.execute = bind_kernel<DependenceType::TRIVIAL>(kernel.type);
+    break;
+  case DependenceType::NO_COMM:
+    bound.execute = bind_kernel<DependenceType::NO_COMM>(kernel.type);
+    break;
+  case DependenceType::STENCIL_1D:
+    bound.execute = bind_kernel<DependenceType::STENCIL_1D>(kernel.type);
+    break;
+  case DependenceType::STENCIL_1D_PERIODIC:
+    bound.execute = bind_kernel<DependenceType::STENCIL_1D_PERIODIC>(kernel.type);
+    break;
+  case DependenceType::DOM:
+    bound.execute = bind_kernel<DependenceType::DOM>(kernel.type);
+    break;
+  case DependenceType::TREE:
+    bound.execute = bind_kernel<DependenceType::TREE>(kernel.type);
+    break;
+  case DependenceType::FFT:
+    bound.execute = bind_kernel<DependenceType::FFT>(kernel.type);
+    break;
+  case DependenceType::ALL_TO_ALL:
+    bound.execute = bind_kernel<DependenceType::ALL_TO_ALL>(kernel.type);
+    break;
+  case DependenceType::NEAREST:
+    bound.execute = bind_kernel<DependenceType::NEAREST>(kernel.type);
+    break;
+  case DependenceType::SPREAD:
+    bound.execute = bind_kernel<DependenceType::SPREAD>(kernel.type);
+    break;
+  case DependenceType::RANDOM_NEAREST:
+    bound.execute = bind_kernel<DependenceType::RANDOM_NEAREST>(kernel.type);
+    break;
+  case DependenceType::RANDOM_SPREAD:
+    bound.execute = bind_kernel<DependenceType::RANDOM_SPREAD>(kernel.type);
+    break;
+  case DependenceType::CHOLESKY_LIKE_RANDOM:
+    bound.execute = bind_kernel<DependenceType::CHOLESKY_LIKE_RANDOM>(kernel.type);
+    break;
+  default:
+    // USER_DEFINED reads its shape from task_info, which gains nothing
+    // from specialization, so it keeps the generic path.
+    bound.execute = &TaskGraph::execute_point_generic;
+    break;
+  };
+  return bound;
+}
+
+void TaskGraph::execute_point_generic(const TaskGraph &graph, long timestep, long point,
+                                      char *output_ptr, size_t output_bytes,
+                                      const char **input_ptr, const size_t *input_bytes,
+                                      size_t n_inputs,
+                                      char *scratch_ptr, size_t scratch_bytes)
+{
+  graph.execute_point(timestep, point, output_ptr, output_bytes,
+                      input_ptr, input_bytes, n_inputs, scratch_ptr, scratch_bytes);
 }
 
 void TaskGraph::execute_point_common(int starpu_cuda, long timestep, long point,
@@ -861,74 +1265,17 @@ void TaskGraph::execute_point_common(int starpu_cuda, long timestep, long point,
   long width = width_at_timestep(timestep);
   assert(offset <= point && point < offset+width);
 
-  long last_offset = offset_at_timestep(timestep-1);
-  long last_width = width_at_timestep(timestep-1);
-
-  // Validate input
-  /*
-  {
-    size_t idx = 0;
-    long dset = dependence_set_at_timestep(timestep);
-    size_t max_deps = num_dependencies(dset, point);
-    std::pair<long, long> *deps = reinterpret_cast<std::pair<long, long> *>(alloca(sizeof(std::pair<long, long>) * max_deps));
-    size_t num_deps = dependencies(dset, point, deps);
-    for (size_t span = 0; span < num_deps; span++) {
-      for (long dep = deps[span].first; dep <= deps[span].second; dep++) {
-        if (last_offset <= dep && dep < last_offset + last_width) {
-          assert(idx < n_inputs);
-
-          assert(input_bytes[idx] == output_bytes_per_task);
-          assert(input_bytes[idx] >= sizeof(std::pair<long, long>));
-
-          const std::pair<long, long> *input = reinterpret_cast<const std::pair<long, long> *>(input_ptr[idx]);
-          for (size_t i = 0; i < input_bytes[idx]/sizeof(std::pair<long, long>); ++i) {
-#ifdef DEBUG_CORE
-            if (input[i].first != timestep - 1 || input[i].second != dep) {
-              printf("ERROR: Task Bench detected corrupted value in task (graph %ld timestep %ld point %ld) input %ld\n  At position %lu within the buffer, expected value (timestep %ld point %ld) but got (timestep %ld point %ld)\n",
-                     graph_index, timestep, point, idx,
-                     i, timestep - 1, dep, input[i].first, input[i].second);
-              fflush(stdout);
-            }
-#endif
-            assert(input[i].first == timestep - 1);
-            assert(input[i].second == dep);
-          }
-          idx++;
-        }
-      }
-    }
-    // FIXME (Elliott): Legion is currently passing in uninitialized
-    // memory for dependencies outside of the last offset/width.
-    // assert(idx == n_inputs);
-  }
-
-  // Validate output
-  assert(output_bytes == output_bytes_per_task);
-  assert(output_bytes >= sizeof(std::pair<long, long>));
+  // Buffers of CUDA tasks live on the device, and custom DAGs are not
+  // described by dependencies(), so only host tasks of generated
+  // graphs are validated.
+  if (starpu_cuda == 0 && dependence != DependenceType::USER_DEFINED &&
+      validation != ValidationLevel::VALIDATE_NONE) {
+    validate_inputs(dependence, timestep, point, input_ptr, input_bytes, n_inputs);
 
-  // Generate output
-  std::pair<long, long> *output = reinterpret_cast<std::pair<long, long> *>(output_ptr);
-  for (size_t i = 0; i < output_bytes/sizeof(std::pair<long, long>); ++i) {
-    output[i].first = timestep;
-    output[i].second = point;
-  }
-
-  // Validate scratch
-  assert(scratch_bytes == scratch_bytes_per_task);
-  if (scratch_bytes > 0) {
-    uint64_t *scratch = reinterpret_cast<uint64_t *>(scratch_ptr);
-    assert(*scratch == MAGIC_VALUE);
+    size_t point_output_bytes = output_bytes_at_point(timestep, point);
+    assert(output_bytes >= point_output_bytes);
+    fill_output(output_ptr, point_output_bytes, timestep, point);
   }
-  */
-  // std::pair<long, long> *output = reinterpret_cast<std::pair<long, long> *>(output_ptr);
-  // for (size_t i = 0; i < output_bytes/sizeof(std::pair<long, long>); ++i) {
-  //   output[i].first = timestep;
-  //   output[i].second = point;
-  // }
-  // if (scratch_bytes > 0) {
-  //   uint64_t *scratch = reinterpret_cast<uint64_t *>(scratch_ptr);
-  //   assert(*scratch == MAGIC_VALUE);
-  // }
 
   double expect_execute_time = getTaskExecTimeAtPoint(timestep, point, starpu_cuda);
 
@@ -942,6 +1289,16 @@ void TaskGraph::execute_point_common(int starpu_cuda, long timestep, long point,
   }
 }
 
+// Graphs of the live App, indexed by graph_index. Filled when the App is
+// constructed and only read afterwards, so lookups need no locking.
+static std::vector<const TaskGraph *> graph_registry;
+
+const TaskGraph &TaskGraph::from_handle(long handle)
+{
+  assert(handle >= 0 && handle < (long)graph_registry.size());
+  return *graph_registry[handle];
+}
+
 void TaskGraph::prepare_scratch(char *scratch_ptr, size_t scratch_bytes)
 {
   assert(scratch_bytes % sizeof(uint64_t) == 0);
@@ -962,9 +1319,13 @@ static TaskGraph default_graph(long graph_index)
   graph.radix = 3;
   graph.period = -1;
   graph.fraction_connected = 0.25;
-  graph.kernel = {KernelType::EMPTY, 0, 16, 0.0};
+  graph.kernel = {KernelType::EMPTY, 0, 16, 0.0, ImbalanceDistribution::IMBALANCE_UNIFORM, 0.0, 1, 1};
   graph.output_bytes_per_task = sizeof(std::pair<long, long>);
+  graph.min_output_bytes_per_task = sizeof(std::pair<long, long>);
+  graph.output_distribution = OutputDistribution::OUTPUT_CONSTANT;
   graph.scratch_bytes_per_task = 0;
+  graph.validation = ValidationLevel::VALIDATE_FULL;
+  graph.validation_samples = 16;
   graph.nb_fields = 0;
   
   return graph;
@@ -988,13 +1349,28 @@ static void needs_argument(int i, int argc, const char *flag) {
 #define KERNEL_FLAG "-kernel"
 #define ITER_FLAG "-iter"
 #define OUTPUT_FLAG "-output"
+#define OUTPUT_DIST_FLAG "-output-dist"
+#define OUTPUT_MIN_FLAG "-output-min"
 #define SCRATCH_FLAG "-scratch"
 #define SAMPLE_FLAG "-sample"
+#define VALIDATE_FLAG "-validate"
+#define VALIDATE_SAMPLES_FLAG "-validate-samples"
 #define IMBALANCE_FLAG "-imbalance"
+#define IMBALANCE_DIST_FLAG "-imbalance-dist"
+#define IMBALANCE_PARAM_FLAG "-imbalance-param"
+#define IMBALANCE_CORR_WIDTH_FLAG "-imbalance-corr-width"
+#define IMBALANCE_CORR_STEPS_FLAG "-imbalance-corr-steps"
 
 #define NODES_FLAG "-nodes"
 #define SKIP_GRAPH_VALIDATION_FLAG "-skip-graph-validation"
 #define FIELD_FLAG "-field"
+#define ALLOC_FLAG "-alloc"
+#define ALLOC_NODE_FLAG "-alloc-node"
+#define HUGE_PAGES_FLAG "-huge-pages"
+#define SUBMIT_FLAG "-submit"
+#define SCRATCH_POLICY_FLAG "-scratch-policy"
+#define SCRATCH_RING_FLAG "-scratch-ring"
+#define POINT_RESIDENT_FLAG "-point-resident"
 
 static void show_help_message(int argc, char **argv) {
   printf("%s: A Task Benchmark\n", argc > 0 ? argv[0] : "task_bench");
@@ -1017,10 +1393,18 @@ static void show_help_message(int argc, char **argv) {
   printf("\nOptions for configuring kernels:\n");
   printf("  %-18s kernel type (see available list below)\n", KERNEL_FLAG " [KERNEL]");
   printf("  %-18s number of iterations\n", ITER_FLAG " [INT]");
-  printf("  %-18s output bytes per task\n", OUTPUT_FLAG " [INT]");
+  printf("  %-18s output bytes per task (maximum when sizes vary)\n", OUTPUT_FLAG " [INT]");
+  printf("  %-18s distribution of output bytes (constant, uniform, loguniform)\n", OUTPUT_DIST_FLAG " [DIST]");
+  printf("  %-18s minimum output bytes per task (only for uniform and loguniform)\n", OUTPUT_MIN_FLAG " [INT]");
   printf("  %-18s scratch bytes per task (only for memory-bound kernel)\n", SCRATCH_FLAG " [INT]");
   printf("  %-18s number of samples (only for memory-bound kernel)\n", SAMPLE_FLAG " [INT]");
+  printf("  %-18s validation of task outputs (full, sampled, checksum, none)\n", VALIDATE_FLAG " [LEVEL]");
+  printf("  %-18s positions checked per input (only for sampled validation)\n", VALIDATE_SAMPLES_FLAG " [INT]");
   printf("  %-18s amount of load imbalance\n", IMBALANCE_FLAG " [FLOAT]");
+  printf("  %-18s distribution of load imbalance (see available list below)\n", IMBALANCE_DIST_FLAG " [DIST]");
+  printf("  %-18s heavy task factor (bimodal) or shape (pareto)\n", IMBALANCE_PARAM_FLAG " [FLOAT]");
+  printf("  %-18s number of neighboring points with correlated imbalance\n", IMBALANCE_CORR_WIDTH_FLAG " [INT]");
+  printf("  %-18s number of consecutive timesteps with correlated imbalance\n", IMBALANCE_CORR_STEPS_FLAG " [INT]");
 
   printf("\nSupported dependency patterns:\n");
   for (auto dtype : dtype_by_name) {
@@ -1032,15 +1416,34 @@ static void show_help_message(int argc, char **argv) {
     printf("  %s\n", ktype.first.c_str());
   }
 
+  printf("\nSupported imbalance distributions:\n");
+  printf("  %-18s iterations scaled by U[1-imbalance/2, 1+imbalance/2]\n", "uniform");
+  printf("  %-18s iterations scaled by max(0, N(1, imbalance))\n", "normal");
+  printf("  %-18s iterations scaled by lognormal with mean 1 and sigma imbalance\n", "lognormal");
+  printf("  %-18s fraction imbalance of tasks run param times the iterations\n", "bimodal");
+  printf("  %-18s iterations scaled by pareto with mean 1 and shape param\n", "pareto");
+
   printf("\nLess frequently used options:\n");
   printf("  %-18s number of fields (optimization for certain task bench implementations)\n", FIELD_FLAG " [INT]");
   printf("  %-18s skip task graph validation\n", SKIP_GRAPH_VALIDATION_FLAG);
+  printf("  %-18s buffer placement (default, first-touch, interleave, node)\n", ALLOC_FLAG " [POLICY]");
+  printf("  %-18s NUMA node for buffers (only for -alloc node)\n", ALLOC_NODE_FLAG " [INT]");
+  printf("  %-18s huge pages for buffers (none, transparent, explicit)\n", HUGE_PAGES_FLAG " [MODE]");
+  printf("  %-18s order of submission across graphs (sequential, round-robin, weighted)\n", SUBMIT_FLAG " [POLICY]");
+  printf("  %-18s scratch reuse (worker, ring, point, task; default depends on implementation)\n", SCRATCH_POLICY_FLAG " [POLICY]");
+  printf("  %-18s scratch blocks per worker (only for ring)\n", SCRATCH_RING_FLAG " [INT]");
+  printf("  %-18s scratch owned by points; report core/NUMA migrations\n", POINT_RESIDENT_FLAG);
 }
 
 App::App(int argc, char **argv)
   : nodes(0)
   , verbose(0)
   , enable_graph_validation(true)
+  , alloc_policy(task_bench_default_alloc_policy())
+  , submission(SUBMIT_SEQUENTIAL)
+  , scratch_policy(SCRATCH_DEFAULT)
+  , scratch_ring(8)
+  , point_resident(false)
 {
   TaskGraph graph = default_graph(graphs.size());
 
@@ -1166,6 +1569,28 @@ App::App(int argc, char **argv)
       graph.output_bytes_per_task = value;
     }
 
+    if (!strcmp(argv[i], OUTPUT_DIST_FLAG)) {
+      needs_argument(i, argc, OUTPUT_DIST_FLAG);
+      auto name = argv[++i];
+      auto dist = odist_by_name.find(name);
+      if (dist == odist_by_name.end()) {
+        fprintf(stderr, "error: Invalid flag \"" OUTPUT_DIST_FLAG " %s\"\n", name);
+        abort();
+      }
+      graph.output_distribution = dist->second;
+    }
+
+    if (!strcmp(argv[i], OUTPUT_MIN_FLAG)) {
+      needs_argument(i, argc, OUTPUT_MIN_FLAG);
+      long value  = atol(argv[++i]);
+      if (value < sizeof(std::pair<long, long>)) {
+        fprintf(stderr, "error: Invalid flag \"" OUTPUT_MIN_FLAG " %ld\" must be >= %lu\n",
+                value, sizeof(std::pair<long, long>));
+        abort();
+      }
+      graph.min_output_bytes_per_task = value;
+    }
+
     if (!strcmp(argv[i], SCRATCH_FLAG)) {
       needs_argument(i, argc, SCRATCH_FLAG);
       long value  = atol(argv[++i]);
@@ -1186,6 +1611,27 @@ App::App(int argc, char **argv)
       graph.kernel.samples = value;
     }
 
+    if (!strcmp(argv[i], VALIDATE_FLAG)) {
+      needs_argument(i, argc, VALIDATE_FLAG);
+      auto name = argv[++i];
+      auto level = validation_by_name.find(name);
+      if (level == validation_by_name.end()) {
+        fprintf(stderr, "error: Invalid flag \"" VALIDATE_FLAG " %s\"\n", name);
+        abort();
+      }
+      graph.validation = level->second;
+    }
+
+    if (!strcmp(argv[i], VALIDATE_SAMPLES_FLAG)) {
+      needs_argument(i, argc, VALIDATE_SAMPLES_FLAG);
+      long value = atol(argv[++i]);
+      if (value < 0) {
+        fprintf(stderr, "error: Invalid flag \"" VALIDATE_SAMPLES_FLAG " %ld\" must be >= 0\n", value);
+        abort();
+      }
+      graph.validation_samples = value;
+    }
+
     if (!strcmp(argv[i], IMBALANCE_FLAG)) {
       needs_argument(i, argc, IMBALANCE_FLAG);
       double value = atof(argv[++i]);
@@ -1195,7 +1641,116 @@ App::App(int argc, char **argv)
       }
       graph.kernel.imbalance = value;
     }
+
+    if (!strcmp(argv[i], IMBALANCE_DIST_FLAG)) {
+      needs_argument(i, argc, IMBALANCE_DIST_FLAG);
+      auto name = argv[++i];
+      auto dist = idist_by_name.find(name);
+      if (dist == idist_by_name.end()) {
+        fprintf(stderr, "error: Invalid flag \"" IMBALANCE_DIST_FLAG " %s\"\n", name);
+        abort();
+      }
+      graph.kernel.imbalance_distribution = dist->second;
+    }
+
+    if (!strcmp(argv[i], IMBALANCE_PARAM_FLAG)) {
+      needs_argument(i, argc, IMBALANCE_PARAM_FLAG);
+      double value = atof(argv[++i]);
+      if (value <= 0) {
+        fprintf(stderr, "error: Invalid flag \"" IMBALANCE_PARAM_FLAG " %f\" must be > 0\n", value);
+        abort();
+      }
+      graph.kernel.imbalance_param = value;
+    }
+
+    if (!strcmp(argv[i], IMBALANCE_CORR_WIDTH_FLAG)) {
+      needs_argument(i, argc, IMBALANCE_CORR_WIDTH_FLAG);
+      long value = atol(argv[++i]);
+      if (value <= 0) {
+        fprintf(stderr, "error: Invalid flag \"" IMBALANCE_CORR_WIDTH_FLAG " %ld\" must be > 0\n", value);
+        abort();
+      }
+      graph.kernel.imbalance_corr_width = value;
+    }
+
+    if (!strcmp(argv[i], IMBALANCE_CORR_STEPS_FLAG)) {
+      needs_argument(i, argc, IMBALANCE_CORR_STEPS_FLAG);
+      long value = atol(argv[++i]);
+      if (value <= 0) {
+        fprintf(stderr, "error: Invalid flag \"" IMBALANCE_CORR_STEPS_FLAG " %ld\" must be > 0\n", value);
+        abort();
+      }
+      graph.kernel.imbalance_corr_steps = value;
+    }
     
+    if (!strcmp(argv[i], ALLOC_FLAG)) {
+      needs_argument(i, argc, ALLOC_FLAG);
+      auto name = argv[++i];
+      auto placement = placement_by_name.find(name);
+      if (placement == placement_by_name.end()) {
+        fprintf(stderr, "error: Invalid flag \"" ALLOC_FLAG " %s\"\n", name);
+        abort();
+      }
+      alloc_policy.placement = placement->second;
+    }
+
+    if (!strcmp(argv[i], ALLOC_NODE_FLAG)) {
+      needs_argument(i, argc, ALLOC_NODE_FLAG);
+      int value = atoi(argv[++i]);
+      if (value < 0) {
+        fprintf(stderr, "error: Invalid flag \"" ALLOC_NODE_FLAG " %d\" must be >= 0\n", value);
+        abort();
+      }
+      alloc_policy.node = value;
+    }
+
+    if (!strcmp(argv[i], HUGE_PAGES_FLAG)) {
+      needs_argument(i, argc, HUGE_PAGES_FLAG);
+      auto name = argv[++i];
+      auto pages = pages_by_name.find(name);
+      if (pages == pages_by_name.end()) {
+        fprintf(stderr, "error: Invalid flag \"" HUGE_PAGES_FLAG " %s\"\n", name);
+        abort();
+      }
+      alloc_policy.pages = pages->second;
+    }
+
+    if (!strcmp(argv[i], SUBMIT_FLAG)) {
+      needs_argument(i, argc, SUBMIT_FLAG);
+      auto name = argv[++i];
+      auto policy = submission_by_name.find(name);
+      if (policy == submission_by_name.end()) {
+        fprintf(stderr, "error: Invalid flag \"" SUBMIT_FLAG " %s\"\n", name);
+        abort();
+      }
+      submission = policy->second;
+    }
+
+    if (!strcmp(argv[i], SCRATCH_POLICY_FLAG)) {
+      needs_argument(i, argc, SCRATCH_POLICY_FLAG);
+      auto name = argv[++i];
+      auto policy = scratch_policy_by_name.find(name);
+      if (policy == scratch_policy_by_name.end()) {
+        fprintf(stderr, "error: Invalid flag \"" SCRATCH_POLICY_FLAG " %s\"\n", name);
+        abort();
+      }
+      scratch_policy = policy->second;
+    }
+
+    if (!strcmp(argv[i], SCRATCH_RING_FLAG)) {
+      needs_argument(i, argc, SCRATCH_RING_FLAG);
+      long value = atol(argv[++i]);
+      if (value <= 0) {
+        fprintf(stderr, "error: Invalid flag \"" SCRATCH_RING_FLAG " %ld\" must be > 0\n", value);
+        abort();
+      }
+      scratch_ring = value;
+    }
+
+    if (!strcmp(argv[i], POINT_RESIDENT_FLAG)) {
+      point_resident = true;
+    }
+
     if (!strcmp(argv[i], FIELD_FLAG)) {
       needs_argument(i, argc, FIELD_FLAG);
       int value  = atoi(argv[++i]);
@@ -1222,17 +1777,38 @@ App::App(int argc, char **argv)
   
   graphs.push_back(graph);
 
-  // check nb_fields, if not set by user, set it to timesteps
+  if (point_resident) {
+    if (scratch_policy != SCRATCH_DEFAULT && scratch_policy != SCRATCH_PER_POINT) {
+      fprintf(stderr, "error: Flag \"" POINT_RESIDENT_FLAG "\" requires scratch policy point\n");
+      abort();
+    }
+    scratch_policy = SCRATCH_PER_POINT;
+  }
+
+  // check nb_fields, if not set by user, keep only as many as the pattern reads
   for (int j = 0; j < graphs.size(); j++) {
     TaskGraph &g = graphs[j];
     if (g.nb_fields == 0) {
-      g.nb_fields = g.timesteps;
+      g.nb_fields = g.min_nb_fields();
     }
   }
   
+  // The most recently constructed App owns the handles.
+  graph_registry.clear();
+  for (auto &g : graphs) {
+    graph_registry.push_back(&g);
+  }
+
   check();
 }
 
+App::~App()
+{
+  if (!graph_registry.empty() && graph_registry[0] == &graphs[0]) {
+    graph_registry.clear();
+  }
+}
+
 void App::check() const
 {
 #ifdef USER_DEFINED_DEBUG
@@ -1266,6 +1842,27 @@ void App::check() const
       abort();
     }
 
+    if (g.output_distribution != OutputDistribution::OUTPUT_CONSTANT &&
+        g.min_output_bytes_per_task > g.output_bytes_per_task) {
+      fprintf(stderr, "error: Minimum output bytes %lu must be at most output bytes %lu\n",
+              g.min_output_bytes_per_task, g.output_bytes_per_task);
+      abort();
+    }
+
+    if ((g.kernel.imbalance_distribution == ImbalanceDistribution::IMBALANCE_BIMODAL ||
+         g.kernel.imbalance_distribution == ImbalanceDistribution::IMBALANCE_PARETO) &&
+        g.kernel.imbalance_param <= 0) {
+      fprintf(stderr, "error: Imbalance distribution \"%s\" requires a parameter (specify with -imbalance-param)\n",
+              name_by_idist.at(g.kernel.imbalance_distribution).c_str());
+      abort();
+    }
+    if (g.kernel.imbalance_distribution == ImbalanceDistribution::IMBALANCE_BIMODAL &&
+        g.kernel.imbalance > 1) {
+      fprintf(stderr, "error: Imbalance distribution \"%s\" requires an imbalance (fraction of heavy tasks) that is at most 1\n",
+              name_by_idist.at(g.kernel.imbalance_distribution).c_str());
+      abort();
+    }
+
     for (long t = 0; t < g.timesteps; ++t) {
       long offset = g.offset_at_timestep(t);
       long width = g.width_at_timestep(t);
@@ -1312,6 +1909,7 @@ void App::display() const
     printf("    Task Graph %d:\n", i);
     printf("      Time Steps: %ld\n", g.timesteps);
     printf("      Max Width: %ld\n", g.max_width);
+    printf("      Fields: %d\n", g.nb_fields);
     printf("      Dependence Type: %s\n", name_by_dtype.at(g.dependence).c_str());
     printf("      Radix: %ld\n", g.radix);
     printf("      Period: %ld\n", g.period);
@@ -1321,8 +1919,22 @@ void App::display() const
     printf("        Iterations: %ld\n", g.kernel.iterations);
     printf("        Samples: %d\n", g.kernel.samples);
     printf("        Imbalance: %f\n", g.kernel.imbalance);
+    if (g.kernel.type == KernelType::LOAD_IMBALANCE) {
+      printf("        Imbalance Distribution: %s\n", name_by_idist.at(g.kernel.imbalance_distribution).c_str());
+      printf("        Imbalance Parameter: %f\n", g.kernel.imbalance_param);
+      printf("        Imbalance Correlation: %ld points, %ld timesteps\n",
+             g.kernel.imbalance_corr_width, g.kernel.imbalance_corr_steps);
+    }
     printf("      Output Bytes: %lu\n", g.output_bytes_per_task);
+    if (g.output_distribution != OutputDistribution::OUTPUT_CONSTANT) {
+      printf("      Output Distribution: %s\n", name_by_odist.at(g.output_distribution).c_str());
+      printf("      Min Output Bytes: %lu\n", g.min_output_bytes_per_task);
+    }
     printf("      Scratch Bytes: %lu\n", g.scratch_bytes_per_task);
+    printf("      Validation: %s\n", name_by_validation.at(g.validation).c_str());
+    if (g.validation == ValidationLevel::VALIDATE_SAMPLED) {
+      printf("      Validation Samples: %ld\n", g.validation_samples);
+    }
 
     if (verbose > 0) {
       for (long t = 0; t < g.timesteps; ++t) {
@@ -1373,6 +1985,92 @@ void App::display() const
       }
     }
   }
+
+  if (alloc_policy.placement != ALLOC_DEFAULT || alloc_policy.pages != PAGES_DEFAULT) {
+    const char *placement = "default";
+    for (auto &pair : placement_by_name) {
+      if (pair.second == alloc_policy.placement) placement = pair.first.c_str();
+    }
+    const char *pages = "none";
+    for (auto &pair : pages_by_name) {
+      if (pair.second == alloc_policy.pages) pages = pair.first.c_str();
+    }
+    printf("    Buffer Allocation:\n");
+    printf("      Placement: %s\n", placement);
+    if (alloc_policy.placement == ALLOC_NODE_BOUND) {
+      printf("      Node: %d\n", alloc_policy.node);
+    }
+    printf("      Huge Pages: %s\n", pages);
+  }
+
+  if (scratch_policy != SCRATCH_DEFAULT) {
+    for (auto &pair : scratch_policy_by_name) {
+      if (pair.second == scratch_policy) {
+        printf("    Scratch Policy: %s\n", pair.first.c_str());
+      }
+    }
+    if (scratch_policy == SCRATCH_WORKER_RING) {
+      printf("    Scratch Ring: %ld\n", scratch_ring);
+    }
+    if (point_resident) {
+      printf("    Point-Resident Data: yes\n");
+    }
+  }
+
+  if (graphs.size() > 1) {
+    for (auto &pair : submission_by_name) {
+      if (pair.second == submission) {
+        printf("    Submission: %s\n", pair.first.c_str());
+      }
+    }
+  }
+}
+
+std::vector<std::pair<long, long> > App::submission_order() const
+{
+  std::vector<std::pair<long, long> > order;
+  long total = 0;
+  for (auto &g : graphs) {
+    total += g.timesteps;
+  }
+  order.reserve(total);
+
+  if (submission == SUBMIT_SEQUENTIAL) {
+    for (long i = 0; i < (long)graphs.size(); i++) {
+      for (long t = 0; t < graphs[i].timesteps; t++) {
+        order.push_back(std::pair<long, long>(i, t));
+      }
+    }
+    return order;
+  }
+
+  std::vector<long> next(graphs.size(), 0);
+  std::vector<long> submitted(graphs.size(), 0);
+  if (submission == SUBMIT_ROUND_ROBIN) {
+    while ((long)order.size() < total) {
+      for (long i = 0; i < (long)graphs.size(); i++) {
+        if (next[i] < graphs[i].timesteps) {
+          order.push_back(std::pair<long, long>(i, next[i]++));
+        }
+      }
+    }
+  } else {
+    assert(submission == SUBMIT_WEIGHTED);
+    // Narrow graphs get several timesteps in for each one of a wide graph,
+    // so the runtime's window holds a comparable number of tasks from each.
+    while ((long)order.size() < total) {
+      long best = -1;
+      for (long i = 0; i < (long)graphs.size(); i++) {
+        if (next[i] < graphs[i].timesteps &&
+            (best < 0 || submitted[i] < submitted[best])) {
+          best = i;
+        }
+      }
+      submitted[best] += graphs[best].width_at_timestep(next[best]);
+      order.push_back(std::pair<long, long>(best, next[best]++));
+    }
+  }
+  return order;
 }
 
 // IMPORTANT: Keep this up-to-date with kernel implementations
@@ -1484,6 +2182,22 @@ static std::tuple<long, long> clamp(long start, long end, long min_value, long m
   }
 }
 
+// Sum of the output sizes of points first..last (inclusive) at timestep
+static long long count_output_bytes(const TaskGraph &g, long timestep, long first, long last)
+{
+  if (first > last) {
+    return 0;
+  }
+  if (g.output_distribution == OutputDistribution::OUTPUT_CONSTANT) {
+    return (last - first + 1) * (long long)g.output_bytes_per_task;
+  }
+  long long bytes = 0;
+  for (long point = first; point <= last; ++point) {
+    bytes += g.output_bytes_at_point(timestep, point);
+  }
+  return bytes;
+}
+
 void App::report_timing(double elapsed_seconds) const
 {
   long long total_num_tasks = 0;
@@ -1499,6 +2213,8 @@ void App::report_timing(double elapsed_seconds) const
     long long num_deps = 0;
     long long local_deps = 0;
     long long nonlocal_deps = 0;
+    long long local_bytes = 0;
+    long long nonlocal_bytes = 0;
 #ifdef DEBUG_CORE
     if (enable_graph_validation) {
       assert((has_executed_graph.load() & (1 << g.graph_index)) != 0);
@@ -1535,16 +2251,24 @@ void App::report_timing(double elapsed_seconds) const
             num_deps += dep_last - dep_first + 1;
             if (nodes > 0) {
               long initial_first, initial_last, local_first, local_last, final_first, final_last;
-              // std::tie(initial_first, initial_last) = clamp(dep_first, dep_last, 0, node_first - 1);
-              // std::tie(local_first, local_last) = clamp(dep_first, dep_last, node_first, node_last);
-              // std::tie(final_first, final_last) = clamp(dep_first, dep_last, node_last + 1, g.max_width - 1);
-              // nonlocal_deps += initial_last - initial_first + 1;
-              // local_deps += local_last - local_first + 1;
-              // nonlocal_deps += final_last - final_first + 1;
+              std::tie(initial_first, initial_last) = clamp(dep_first, dep_last, 0, node_first - 1);
+              std::tie(local_first, local_last) = clamp(dep_first, dep_last, node_first, node_last);
+              std::tie(final_first, final_last) = clamp(dep_first, dep_last, node_last + 1, g.max_width - 1);
+              nonlocal_deps += initial_last - initial_first + 1;
+              local_deps += local_last - local_first + 1;
+              nonlocal_deps += final_last - final_first + 1;
+              nonlocal_bytes += count_output_bytes(g, t-1, initial_first, initial_last);
+              local_bytes += count_output_bytes(g, t-1, local_first, local_last);
+              nonlocal_bytes += count_output_bytes(g, t-1, final_first, final_last);
             }
           }
         } else {
           local_deps += deps.size();
+          for (auto dep : deps) {
+            if (dep.first >= 0) {
+              local_bytes += g.output_bytes_at_point(dep.first, dep.second);
+            }
+          }
         }
       }
     }
@@ -1555,8 +2279,8 @@ void App::report_timing(double elapsed_seconds) const
     total_nonlocal_deps += nonlocal_deps;
     // flops += count_flops(g);
     // bytes += count_bytes(g);
-    local_transfer += local_deps * g.output_bytes_per_task;
-    nonlocal_transfer += nonlocal_deps * g.output_bytes_per_task;
+    local_transfer += local_bytes;
+    nonlocal_transfer += nonlocal_bytes;
   }
 
   printf("Total Tasks %lld\n", total_num_tasks);
@@ -1573,6 +2297,9 @@ void App::report_timing(double elapsed_seconds) const
   printf("Elapsed Time %e seconds\n", elapsed_seconds);
   printf("FLOP/s %e\n", flops/elapsed_seconds);
   printf("B/s %e\n", bytes/elapsed_seconds);
+  if (task_bench_page_fault_seconds() > 0) {
+    printf("Page Fault Time %e seconds\n", task_bench_page_fault_seconds());
+  }
   printf("Transfer (estimated):\n");
   if (nodes > 0) {
     printf("  Local Bytes %lld\n", local_transfer);
@@ -16,6 +16,8 @@
 #ifndef CORE_H
 #define CORE_H
 
+#include "core_alloc.h"
+#include "core_scratch.h"
 #include "core_c.h"
 #include <cublas_v2.h>
 
@@ -26,6 +28,12 @@ typedef dependence_type_t DependenceType;
 
 typedef kernel_type_t KernelType;
 
+typedef imbalance_distribution_t ImbalanceDistribution;
+
+typedef output_distribution_t OutputDistribution;
+
+typedef validation_level_t ValidationLevel;
+
 struct TaskGraph;
 
 struct Kernel : public kernel_t {
@@ -49,6 +57,29 @@ private:
 
 };
 
+typedef void (*ExecutePointFn)(const TaskGraph &graph, long timestep, long point,
+                               char *output_ptr, size_t output_bytes,
+                               const char **input_ptr, const size_t *input_bytes,
+                               size_t n_inputs,
+                               char *scratch_ptr, size_t scratch_bytes);
+
+// TaskGraph::execute_point with the dependence and kernel type resolved
+// up front. Only valid while the TaskGraph it was bound from is alive.
+struct BoundTaskGraph {
+  const TaskGraph *graph;
+  ExecutePointFn execute;
+
+  inline void execute_point(long timestep, long point,
+                            char *output_ptr, size_t output_bytes,
+                            const char **input_ptr, const size_t *input_bytes,
+                            size_t n_inputs,
+                            char *scratch_ptr, size_t scratch_bytes) const
+  {
+    execute(*graph, timestep, point, output_ptr, output_bytes,
+            input_ptr, input_bytes, n_inputs, scratch_ptr, scratch_bytes);
+  }
+};
+
 struct TaskGraph : public task_graph_t {
   TaskGraph() = default;
   TaskGraph(task_graph_t t) : task_graph_t(t) {}
@@ -61,6 +92,13 @@ struct TaskGraph : public task_graph_t {
   long timestep_period() const;
   long dependence_set_at_timestep(long timestep) const;
 
+  // smallest number of fields (timesteps of outputs kept live) for which
+  // every input is still present when its consumer runs; the default for nb_fields
+  long min_nb_fields() const;
+
+  // number of bytes actually produced by a task, at most output_bytes_per_task
+  size_t output_bytes_at_point(long timestep, long point) const;
+
   // only can be called when dependence type is USER_DEFINED
   void set_task_info(std::string task_info_file);
   void set_task_info(CustomTaskInfo *task_info);
@@ -102,6 +140,59 @@ struct TaskGraph : public task_graph_t {
                      size_t n_inputs,
                      char *scratch_ptr, size_t scratch_bytes, cublasHandle_t handle) const;
   static void prepare_scratch(char *scratch_ptr, size_t scratch_bytes);
+
+  // Look up a graph of the App in this process by its graph_index. The
+  // index is a small, rank-independent handle, so task payloads can
+  // carry it instead of a copy of the TaskGraph. The returned reference
+  // is read-only and stays valid for the lifetime of the App.
+  static const TaskGraph &from_handle(long handle);
+
+  // Resolve execute_point for this graph's dependence and kernel type
+  // once, so that hot loops skip the per-call dispatch.
+  BoundTaskGraph bind() const;
+
+private:
+  // Same as the public methods above, with the dependence type passed
+  // in so that specialized callers can fold the dispatch away. Inline,
+  // and defined in core.cc, the only file that calls them.
+  inline long offset_at_timestep(long timestep, DependenceType dtype) const;
+  inline long width_at_timestep(long timestep, DependenceType dtype) const;
+  inline long max_dependence_sets(DependenceType dtype) const;
+  inline long dependence_set_at_timestep(long timestep, DependenceType dtype) const;
+  inline size_t dependencies(long dset, long point, std::pair<long, long> *deps, DependenceType dtype) const;
+  inline size_t num_dependencies(long dset, long point, DependenceType dtype) const;
+
+  inline void validate_inputs(DependenceType dtype, long timestep, long point,
+                              const char **input_ptr, const size_t *input_bytes,
+                              size_t n_inputs) const;
+  inline void execute_point(DependenceType dtype, KernelType ktype,
+                            long timestep, long point,
+                            char *output_ptr, size_t output_bytes,
+                            const char **input_ptr, const size_t *input_bytes,
+                            size_t n_inputs,
+                            char *scratch_ptr, size_t scratch_bytes) const;
+
+  template<DependenceType D, KernelType K>
+  static void execute_point_bound(const TaskGraph &graph, long timestep, long point,
+                                  char *output_ptr, size_t output_bytes,
+                                  const char **input_ptr, const size_t *input_bytes,
+                                  size_t n_inputs,
+                                  char *scratch_ptr, size_t scratch_bytes);
+  static void execute_point_generic(const TaskGraph &graph, long timestep, long point,
+                                    char *output_ptr, size_t output_bytes,
+                                    const char **input_ptr, const size_t *input_bytes,
+                                    size_t n_inputs,
+                                    char *scratch_ptr, size_t scratch_bytes);
+  template<DependenceType D>
+  static ExecutePointFn bind_kernel(KernelType ktype);
+};
+
+// Order in which backends hand (graph, timestep) pairs to the runtime
+// when several graphs are given with -and.
+enum SubmissionPolicy {
+  SUBMIT_SEQUENTIAL,  // every timestep of graph 0, then graph 1, ...
+  SUBMIT_ROUND_ROBIN, // one timestep of each unfinished graph in turn
+  SUBMIT_WEIGHTED,    // next timestep of the graph with the fewest tasks submitted so far
 };
 
 struct App {
@@ -109,16 +200,25 @@ struct App {
   long nodes;
   int verbose;
   bool enable_graph_validation;
+  alloc_policy_t alloc_policy;
+  SubmissionPolicy submission;
+  ScratchPolicy scratch_policy;
+  long scratch_ring; // blocks per worker under SCRATCH_WORKER_RING
+  bool point_resident; // per-point scratch, with migrations reported by ScratchManager
 
   App(int argc, char **argv);
+  ~App();
   void check() const;
   void display() const;
   void report_timing(double elapsed_seconds) const;
+
+  // (graph index, timestep) pairs covering every graph, in submission order.
+  std::vector<std::pair<long, long> > submission_order() const;
 };
 
-// Make sure core types are POD
-static_assert(std::is_pod<Kernel>::value, "Kernel must be POD");
-static_assert(std::is_pod<TaskGraph>::value, "TaskGraph must be POD");
+// Make sure core types are POD (spelled out, since is_pod is deprecated in C++20)
+static_assert(std::is_trivial<Kernel>::value && std::is_standard_layout<Kernel>::value, "Kernel must be POD");
+static_assert(std::is_trivial<TaskGraph>::value && std::is_standard_layout<TaskGraph>::value, "TaskGraph must be POD");
 
 long long count_flops_per_task(const TaskGraph &g, long timestep, long point);
 long long count_bytes_per_task(const TaskGraph &g, long timestep, long point);
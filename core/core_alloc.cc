@@ -0,0 +1,225 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core_alloc.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+// Buffers smaller than this share pages with their neighbors, so there is
+// nothing to place; they come from posix_memalign instead of mmap.
+#define MIN_MAPPED_BYTES (64UL << 10)
+
+struct AllocRecord {
+  size_t mapped_bytes; // 0 for posix_memalign
+};
+
+static std::mutex alloc_mutex;
+static std::unordered_map<void *, AllocRecord> alloc_records;
+static std::atomic<unsigned long long> page_fault_nanoseconds(0);
+
+static size_t page_size()
+{
+  static size_t size = sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+static size_t round_up(size_t bytes, size_t multiple)
+{
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+#ifdef __linux__
+static int count_numa_nodes()
+{
+  int nodes = 0;
+  char path[64];
+  while (true) {
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", nodes);
+    if (access(path, F_OK) != 0) break;
+    nodes++;
+  }
+  return nodes > 0 ? nodes : 1;
+}
+
+static void bind_pages(void *ptr, size_t bytes, alloc_policy_t policy)
+{
+  const size_t bits = 8 * sizeof(unsigned long);
+  unsigned long mask[16] = {0};
+  int mode;
+  if (policy.placement == ALLOC_INTERLEAVED) {
+    int nodes = count_numa_nodes();
+    for (int n = 0; n < nodes && n < (int)(16 * bits); n++) {
+      mask[n / bits] |= 1UL << (n % bits);
+    }
+    mode = MPOL_INTERLEAVE;
+  } else {
+    assert(policy.placement == ALLOC_NODE_BOUND);
+    if (policy.node < 0 || policy.node >= count_numa_nodes()) {
+      fprintf(stderr, "error: NUMA node %d does not exist\n", policy.node);
+      abort();
+    }
+    mask[policy.node / bits] |= 1UL << (policy.node % bits);
+    mode = MPOL_BIND;
+  }
+  if (syscall(SYS_mbind, ptr, bytes, mode, mask, 16 * bits, 0) != 0) {
+    // Not fatal: kernels without NUMA support reject mbind.
+    perror("warning: mbind");
+  }
+}
+#endif
+
+static void *map_pages(size_t bytes, alloc_policy_t policy, size_t &mapped_bytes)
+{
+  void *ptr = MAP_FAILED;
+  mapped_bytes = round_up(bytes, page_size());
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  if (policy.pages == PAGES_EXPLICIT_HUGE) {
+    size_t huge_bytes = round_up(bytes, HUGE_PAGE_SIZE);
+    ptr = mmap(NULL, huge_bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      mapped_bytes = huge_bytes;
+    }
+  }
+#endif
+
+  if (ptr == MAP_FAILED) {
+    ptr = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      perror("error: mmap");
+      abort();
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (policy.pages != PAGES_DEFAULT) {
+      madvise(ptr, mapped_bytes, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+#ifdef __linux__
+  if (policy.placement == ALLOC_INTERLEAVED || policy.placement == ALLOC_NODE_BOUND) {
+    bind_pages(ptr, mapped_bytes, policy);
+  }
+#endif
+
+  return ptr;
+}
+
+alloc_policy_t task_bench_default_alloc_policy()
+{
+  alloc_policy_t policy;
+  policy.placement = ALLOC_DEFAULT;
+  policy.pages = PAGES_DEFAULT;
+  policy.node = 0;
+  policy.alignment = TASK_BENCH_CACHE_LINE;
+  return policy;
+}
+
+void *task_bench_alloc(size_t bytes, alloc_policy_t policy)
+{
+  if (policy.alignment < TASK_BENCH_CACHE_LINE) {
+    policy.alignment = TASK_BENCH_CACHE_LINE;
+  }
+  assert((policy.alignment & (policy.alignment - 1)) == 0);
+  assert(policy.alignment <= page_size());
+
+  if (bytes == 0) {
+    bytes = 1;
+  }
+
+  bool use_mmap = bytes >= MIN_MAPPED_BYTES &&
+                  (policy.placement != ALLOC_DEFAULT || policy.pages != PAGES_DEFAULT);
+
+  void *ptr = NULL;
+  AllocRecord record = {0};
+  if (use_mmap) {
+    ptr = map_pages(bytes, policy, record.mapped_bytes);
+  } else {
+    size_t padded_bytes = round_up(bytes, TASK_BENCH_CACHE_LINE);
+    if (posix_memalign(&ptr, policy.alignment, padded_bytes) != 0) {
+      fprintf(stderr, "error: failed to allocate %lu bytes\n", padded_bytes);
+      abort();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(alloc_mutex);
+    alloc_records[ptr] = record;
+  }
+
+  if (policy.placement != ALLOC_DEFAULT && policy.placement != ALLOC_FIRST_TOUCH) {
+    task_bench_first_touch(ptr, bytes);
+  }
+  return ptr;
+}
+
+void task_bench_free(void *ptr)
+{
+  if (ptr == NULL) return;
+
+  AllocRecord record;
+  {
+    std::lock_guard<std::mutex> lock(alloc_mutex);
+    auto it = alloc_records.find(ptr);
+    assert(it != alloc_records.end());
+    record = it->second;
+    alloc_records.erase(it);
+  }
+
+  if (record.mapped_bytes > 0) {
+    munmap(ptr, record.mapped_bytes);
+  } else {
+    free(ptr);
+  }
+}
+
+void task_bench_first_touch(void *ptr, size_t bytes)
+{
+  if (ptr == NULL || bytes == 0) return;
+
+  auto start = std::chrono::steady_clock::now();
+  volatile char *data = (volatile char *)ptr;
+  for (size_t i = 0; i < bytes; i += page_size()) {
+    data[i] = data[i];
+  }
+  data[bytes - 1] = data[bytes - 1];
+  auto stop = std::chrono::steady_clock::now();
+
+  page_fault_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+}
+
+double task_bench_page_fault_seconds()
+{
+  return page_fault_nanoseconds.load() / 1e9;
+}
@@ -0,0 +1,66 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CORE_ALLOC_H
+#define CORE_ALLOC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TASK_BENCH_CACHE_LINE 64
+
+typedef enum alloc_placement_t {
+  ALLOC_DEFAULT,      // whatever malloc and the OS do
+  ALLOC_FIRST_TOUCH,  // pages stay untouched until the owning worker calls task_bench_first_touch
+  ALLOC_INTERLEAVED,  // pages interleaved round-robin across all NUMA nodes
+  ALLOC_NODE_BOUND,   // pages bound to alloc_policy_t.node
+} alloc_placement_t;
+
+typedef enum alloc_pages_t {
+  PAGES_DEFAULT,
+  PAGES_TRANSPARENT_HUGE, // madvise(MADV_HUGEPAGE)
+  PAGES_EXPLICIT_HUGE,    // MAP_HUGETLB, falls back to transparent if the pool is empty
+} alloc_pages_t;
+
+typedef struct alloc_policy_t {
+  alloc_placement_t placement;
+  alloc_pages_t pages;
+  int node; // only for ALLOC_NODE_BOUND
+  size_t alignment; // power of two, at least TASK_BENCH_CACHE_LINE
+} alloc_policy_t;
+
+alloc_policy_t task_bench_default_alloc_policy(void);
+
+// Allocate bytes according to policy. Never returns NULL. Placement
+// policies other than ALLOC_FIRST_TOUCH are pre-faulted before
+// returning, and the time spent is added to the page fault counter.
+void *task_bench_alloc(size_t bytes, alloc_policy_t policy);
+void task_bench_free(void *ptr);
+
+// Touch every page of [ptr, ptr+bytes) from the calling thread so that
+// it is placed on the caller's node. Safe to call concurrently.
+void task_bench_first_touch(void *ptr, size_t bytes);
+
+// Total wall time spent pre-faulting pages, summed over all threads.
+double task_bench_page_fault_seconds(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -86,6 +86,12 @@ long task_graph_dependence_set_at_timestep(task_graph_t graph, long timestep)
   return t.dependence_set_at_timestep(timestep);
 }
 
+size_t task_graph_output_bytes_at_point(task_graph_t graph, long timestep, long point)
+{
+  TaskGraph t(graph);
+  return t.output_bytes_at_point(timestep, point);
+}
+
 interval_list_t task_graph_reverse_dependencies(task_graph_t graph, long dset, long point)
 {
   TaskGraph t(graph);
@@ -56,11 +56,29 @@ typedef enum kernel_type_t {
   CUSTOMIZE,
 } kernel_type_t;
 
+typedef enum imbalance_distribution_t {
+  IMBALANCE_UNIFORM,
+  IMBALANCE_NORMAL,
+  IMBALANCE_LOGNORMAL,
+  IMBALANCE_BIMODAL,
+  IMBALANCE_PARETO,
+} imbalance_distribution_t;
+
+typedef enum output_distribution_t {
+  OUTPUT_CONSTANT,
+  OUTPUT_UNIFORM,
+  OUTPUT_LOGUNIFORM,
+} output_distribution_t;
+
 typedef struct kernel_t {
   kernel_type_t type;
   long iterations;
   int samples;
   double imbalance; // amount of imbalance as a fraction of the number of iterations
+  imbalance_distribution_t imbalance_distribution;
+  double imbalance_param; // bimodal: heavy task factor, pareto: shape
+  long imbalance_corr_width; // number of neighboring points that share a draw
+  long imbalance_corr_steps; // number of consecutive timesteps that share a draw
 } kernel_t;
 
 typedef struct interval_t {
@@ -77,6 +95,13 @@ void interval_list_destroy(interval_list_t intervals);
 long interval_list_num_intervals(interval_list_t intervals);
 interval_t interval_list_interval(interval_list_t intervals, long index);
 
+typedef enum validation_level_t {
+  VALIDATE_FULL,     // every pair of every input
+  VALIDATE_SAMPLED,  // first and last pair plus validation_samples random pairs
+  VALIDATE_CHECKSUM, // lane-wise sums over the whole buffer
+  VALIDATE_NONE,
+} validation_level_t;
+
 typedef struct task_graph_t {
   long graph_index;
   long timesteps;
@@ -86,8 +111,12 @@ typedef struct task_graph_t {
   long period; // period of repetition in spread/random pattern
   double fraction_connected; // fraction of connected nodes in random pattern
   kernel_t kernel;
-  size_t output_bytes_per_task;
+  size_t output_bytes_per_task; // maximum when output sizes vary
+  size_t min_output_bytes_per_task;
+  output_distribution_t output_distribution;
   size_t scratch_bytes_per_task;
+  validation_level_t validation;
+  long validation_samples; // only for sampled validation
   int nb_fields;
   CustomTaskInfo *task_info;
 } task_graph_t;
@@ -97,6 +126,7 @@ long task_graph_width_at_timestep(task_graph_t graph, long timestep);
 long task_graph_max_dependence_sets(task_graph_t graph);
 long task_graph_timestep_period(task_graph_t graph);
 long task_graph_dependence_set_at_timestep(task_graph_t graph, long timestep);
+size_t task_graph_output_bytes_at_point(task_graph_t graph, long timestep, long point);
 interval_list_t task_graph_reverse_dependencies(task_graph_t graph, long dset, long point);
 interval_list_t task_graph_dependencies(task_graph_t graph, long dset, long point);
 void task_graph_execute_point_scratch(task_graph_t graph, long timestep, long point,
@@ -13,6 +13,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <thread>
@@ -424,13 +425,69 @@ void execute_kernel_io(const Kernel &kernel)
   assert(false);
 }
 
-long select_imbalance_iterations(const Kernel &kernel,
-                                 long graph_index, long timestep, long point)
+// Heavy-tailed draws are truncated at this multiple of the nominal
+// iteration count to keep the iteration count representable.
+#define MAX_IMBALANCE_FACTOR 1000.0
+
+static double imbalance_normal(long graph_index, long timestep, long point)
+{
+  // Box-Muller transform over two independent deterministic draws.
+  long seed1[3] = {graph_index, timestep, point};
+  long seed2[4] = {graph_index, timestep, point, 1};
+  double u1 = random_uniform(&seed1[0], sizeof(seed1));
+  double u2 = random_uniform(&seed2[0], sizeof(seed2));
+  return sqrt(-2.0 * log(1.0 - u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double imbalance_factor(const Kernel &kernel,
+                               long graph_index, long timestep, long point)
 {
   long seed[3] = {graph_index, timestep, point};
   double value = random_uniform(&seed[0], sizeof(seed));
 
-  long iterations = (long)round((1 + (value - 0.5)*kernel.imbalance) * kernel.iterations);
+  switch (kernel.imbalance_distribution) {
+  case ImbalanceDistribution::IMBALANCE_UNIFORM:
+    return 1 + (value - 0.5)*kernel.imbalance;
+  case ImbalanceDistribution::IMBALANCE_NORMAL:
+  {
+    double z = imbalance_normal(graph_index, timestep, point);
+    return std::max(0.0, 1 + kernel.imbalance*z);
+  }
+  case ImbalanceDistribution::IMBALANCE_LOGNORMAL:
+  {
+    // Mean is 1 for any sigma.
+    double sigma = kernel.imbalance;
+    double z = imbalance_normal(graph_index, timestep, point);
+    return std::min(MAX_IMBALANCE_FACTOR, exp(sigma*z - 0.5*sigma*sigma));
+  }
+  case ImbalanceDistribution::IMBALANCE_BIMODAL:
+    return value < kernel.imbalance ? kernel.imbalance_param : 1.0;
+  case ImbalanceDistribution::IMBALANCE_PARETO:
+  {
+    // Scale is chosen so that the mean is 1 whenever it exists.
+    double shape = kernel.imbalance_param;
+    assert(shape > 0);
+    double scale = shape > 1 ? (shape - 1) / shape : 1.0;
+    return std::min(MAX_IMBALANCE_FACTOR, scale * pow(1.0 - value, -1.0 / shape));
+  }
+  default:
+    assert(false && "unexpected imbalance distribution");
+  };
+  return 1.0;
+}
+
+long select_imbalance_iterations(const Kernel &kernel,
+                                 long graph_index, long timestep, long point)
+{
+  // Points (and timesteps) in the same block share a draw, which
+  // makes neighbors heavy together.
+  assert(kernel.imbalance_corr_width > 0 && kernel.imbalance_corr_steps > 0);
+  long block_timestep = timestep / kernel.imbalance_corr_steps;
+  long block_point = point / kernel.imbalance_corr_width;
+
+  double factor = imbalance_factor(kernel, graph_index, block_timestep, block_point);
+
+  long iterations = (long)round(factor * kernel.iterations);
   assert(iterations >= 0);
   return iterations;
 }
@@ -0,0 +1,211 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core_scratch.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "core.h"
+
+// Packs the caller's core and NUMA node, or returns -1 if unknown.
+static long current_location()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+    return ((long)node << 32) | cpu;
+  }
+#endif
+  return -1;
+}
+
+ScratchManager::ScratchManager(const App &app, int workers, ScratchPolicy native,
+                               int rank, int n_ranks)
+  : policy_(app.scratch_policy == SCRATCH_DEFAULT ? native : app.scratch_policy)
+  , alloc_policy_(app.alloc_policy)
+  , ring_(1)
+  , max_bytes_(0)
+  , workers_(workers)
+  , track_(app.point_resident)
+  , last_location_(NULL)
+{
+  assert(policy_ != SCRATCH_DEFAULT);
+  assert(workers > 0);
+
+  if (policy_ == SCRATCH_WORKER_RING) {
+    ring_ = app.scratch_ring;
+  }
+
+  for (auto &g : app.graphs) {
+    graph_bytes_.push_back(g.scratch_bytes_per_task);
+    if (g.scratch_bytes_per_task > max_bytes_) {
+      max_bytes_ = g.scratch_bytes_per_task;
+    }
+  }
+
+  for (auto &w : workers_) {
+    w.blocks = NULL;
+    w.next = 0;
+    w.tasks = w.core_migrations = w.node_migrations = w.bytes = 0;
+    if (max_bytes_ > 0 &&
+        (policy_ == SCRATCH_PER_WORKER || policy_ == SCRATCH_WORKER_RING)) {
+      w.blocks = (char *)task_bench_alloc(max_bytes_ * ring_, alloc_policy_);
+    }
+  }
+
+  if (policy_ == SCRATCH_PER_POINT) {
+    size_t total_points = 0;
+    for (auto &g : app.graphs) {
+      long first_point = rank * g.max_width / n_ranks;
+      long last_point = (rank + 1) * g.max_width / n_ranks - 1;
+      long n_points = last_point - first_point + 1;
+      first_point_.push_back(first_point);
+      point_offset_.push_back(total_points);
+      total_points += n_points;
+      graphs_.push_back(&g);
+
+      size_t bytes = g.scratch_bytes_per_task * n_points;
+      char *slab = NULL;
+      if (bytes > 0) {
+        slab = (char *)task_bench_alloc(bytes, alloc_policy_);
+        TaskGraph::prepare_scratch(slab, bytes);
+      }
+      point_slabs_.push_back(slab);
+    }
+
+    if (track_) {
+      last_location_ = new std::atomic<long>[total_points];
+      for (size_t i = 0; i < total_points; i++) {
+        last_location_[i] = -1;
+      }
+    }
+  } else {
+    track_ = false;
+  }
+}
+
+ScratchManager::~ScratchManager()
+{
+  for (auto &w : workers_) {
+    task_bench_free(w.blocks);
+  }
+  for (char *slab : point_slabs_) {
+    task_bench_free(slab);
+  }
+  delete [] last_location_;
+}
+
+void ScratchManager::prepare_worker(int worker)
+{
+  char *blocks = workers_[worker].blocks;
+  if (blocks == NULL) return;
+
+  if (alloc_policy_.placement == ALLOC_FIRST_TOUCH) {
+    task_bench_first_touch(blocks, max_bytes_ * ring_);
+  }
+  TaskGraph::prepare_scratch(blocks, max_bytes_ * ring_);
+}
+
+char *ScratchManager::acquire(int worker, long graph_index, long timestep, long point)
+{
+  size_t bytes = graph_bytes_[graph_index];
+  if (bytes == 0) return NULL;
+
+  switch (policy_) {
+  case SCRATCH_PER_WORKER:
+    return workers_[worker].blocks;
+  case SCRATCH_WORKER_RING:
+  {
+    WorkerState &w = workers_[worker];
+    char *block = w.blocks + w.next * max_bytes_;
+    w.next = (w.next + 1) % ring_;
+    return block;
+  }
+  case SCRATCH_PER_POINT:
+    if (track_) {
+      track_locality(worker, graph_index, timestep, point);
+    }
+    return point_slabs_[graph_index] + (point - first_point_[graph_index]) * bytes;
+  case SCRATCH_PER_TASK:
+  {
+    // Plain heap memory: task_bench_alloc serializes on its registry and
+    // may mmap/mbind, which would dominate a per-task allocation.
+    void *block = NULL;
+    if (posix_memalign(&block, TASK_BENCH_CACHE_LINE, bytes) != 0) {
+      fprintf(stderr, "error: Failed to allocate %zu bytes of scratch\n", bytes);
+      abort();
+    }
+    TaskGraph::prepare_scratch((char *)block, bytes);
+    return (char *)block;
+  }
+  default:
+    assert(false && "unexpected scratch policy");
+  }
+  return NULL;
+}
+
+void ScratchManager::release(char *ptr)
+{
+  if (policy_ == SCRATCH_PER_TASK) {
+    free(ptr);
+  }
+}
+
+void ScratchManager::track_locality(int worker, long graph_index, long timestep, long point)
+{
+  WorkerState &w = workers_[worker];
+  long location = current_location();
+  long index = point_offset_[graph_index] + point - first_point_[graph_index];
+  long last = last_location_[index].exchange(location, std::memory_order_relaxed);
+
+  w.tasks++;
+  w.bytes += count_bytes_per_task(*graphs_[graph_index], timestep, point);
+  if (last >= 0 && location >= 0) {
+    if ((last & 0xffffffffL) != (location & 0xffffffffL)) {
+      w.core_migrations++;
+    }
+    if ((last >> 32) != (location >> 32)) {
+      w.node_migrations++;
+    }
+  }
+}
+
+void ScratchManager::report_locality(double elapsed_seconds) const
+{
+  if (!track_) return;
+
+  long long tasks = 0, core_migrations = 0, node_migrations = 0, bytes = 0;
+  for (auto &w : workers_) {
+    tasks += w.tasks;
+    core_migrations += w.core_migrations;
+    node_migrations += w.node_migrations;
+    bytes += w.bytes;
+  }
+
+  double percent = tasks > 0 ? 100.0 / tasks : 0.0;
+  printf("Point-Resident Data:\n");
+  printf("  Tasks %lld\n", tasks);
+  printf("  Core Migrations %lld (%.2f%%)\n", core_migrations, core_migrations * percent);
+  printf("  NUMA Migrations %lld (%.2f%%)\n", node_migrations, node_migrations * percent);
+  printf("  Bytes %lld\n", bytes);
+  printf("  Bandwidth %e B/s\n", bytes/elapsed_seconds);
+}
@@ -0,0 +1,99 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CORE_SCRATCH_H
+#define CORE_SCRATCH_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <vector>
+
+#include "core_alloc.h"
+
+enum ScratchPolicy {
+  SCRATCH_DEFAULT,     // whatever the backend natively does
+  SCRATCH_PER_WORKER,  // one block per worker, reused by every task it runs
+  SCRATCH_WORKER_RING, // ring of App::scratch_ring blocks per worker
+  SCRATCH_PER_POINT,   // one persistent block per (graph, point)
+  SCRATCH_PER_TASK,    // fresh heap block for every task (ignores App::alloc_policy)
+};
+
+struct App;
+struct TaskGraph;
+
+// Hands out scratch blocks to tasks so that every backend can model the
+// same cache behavior. Blocks are sized for the largest
+// scratch_bytes_per_task of any graph (per graph under SCRATCH_PER_POINT).
+class ScratchManager {
+public:
+  // With n_ranks > 1, only the points owned by rank (in the usual
+  // block distribution) get SCRATCH_PER_POINT blocks. native is used
+  // when the user did not pick a policy. app must outlive the manager.
+  ScratchManager(const App &app, int workers, ScratchPolicy native,
+                 int rank = 0, int n_ranks = 1);
+  ~ScratchManager();
+
+  ScratchManager(const ScratchManager &) = delete;
+  ScratchManager &operator=(const ScratchManager &) = delete;
+
+  // Touch (under ALLOC_FIRST_TOUCH) and fill the blocks owned by worker.
+  // Call once from the thread that will run as that worker.
+  void prepare_worker(int worker);
+
+  // Block for one task. Concurrent calls must use distinct workers.
+  // Returns NULL when the graph has no scratch.
+  char *acquire(int worker, long graph_index, long timestep, long point);
+  // Must be paired with every acquire; frees the block under SCRATCH_PER_TASK.
+  void release(char *ptr);
+
+  ScratchPolicy policy() const { return policy_; }
+
+  // Under App::point_resident, prints how often a point ran on a different
+  // core or NUMA node than its previous task, and the bandwidth of the
+  // point-resident blocks. Prints nothing otherwise.
+  void report_locality(double elapsed_seconds) const;
+
+private:
+  // Padded so that counters of different workers never share a line.
+  struct WorkerState {
+    char *blocks;
+    long next; // ring position
+    long long tasks;
+    long long core_migrations;
+    long long node_migrations;
+    long long bytes;
+    char padding[TASK_BENCH_CACHE_LINE];
+  };
+
+  void track_locality(int worker, long graph_index, long timestep, long point);
+
+  ScratchPolicy policy_;
+  alloc_policy_t alloc_policy_;
+  long ring_;
+  size_t max_bytes_;
+  std::vector<WorkerState> workers_;
+  std::vector<size_t> graph_bytes_;
+  std::vector<long> first_point_;
+  std::vector<char *> point_slabs_; // per graph, one block per local point
+
+  // Point-resident tracking: where each local point last ran.
+  bool track_;
+  std::vector<const TaskGraph *> graphs_;
+  std::vector<size_t> point_offset_;
+  std::atomic<long> *last_location_;
+};
+
+#endif
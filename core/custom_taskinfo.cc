@@ -483,6 +483,35 @@ std::string CustomTaskInfo::getTaskTypeAtPoint(long t, long point) const {
     return task2tag.at(task);
 }
 
+void CustomTaskInfo::setTaskOutputBytes(const std::string& file) {
+    std::ifstream infile(file);
+    std::string line;
+    while (std::getline(infile, line)) {
+        size_t pos = line.find(":");
+        if (pos == std::string::npos) {
+            continue;
+        }
+        std::string task_type = trim(line.substr(0, pos));
+        size_t output_bytes = std::stoul(line.substr(pos + 1));
+        taskType2outputBytes[task_type] = output_bytes;
+    }
+}
+
+bool CustomTaskInfo::taskOutputBytesInitialized() const {
+    return !taskType2outputBytes.empty();
+}
+
+size_t CustomTaskInfo::getTaskOutputBytesAtPoint(long t, long point) const {
+    assert(taskOutputBytesInitialized());
+    int task = get_task_by_coordinate(t, point);
+    const std::string& task_type = task2tag.at(task);
+    auto it = taskType2outputBytes.find(task_type);
+    if (it == taskType2outputBytes.end()) {
+        return 0;
+    }
+    return it->second;
+}
+
 bool CustomTaskInfo::validate() {
     assert(taskDepInfoInitialized());
     int task_num = TaskPriority::get_task_num();
@@ -133,7 +133,15 @@ public:
 
     std::string getTaskTypeAtPoint(long t, long point) const;
 
+    // input format: "task_type: output_bytes\n"
+    void setTaskOutputBytes(const std::string& file);
+    bool taskOutputBytesInitialized() const;
+    // 0 if the task's type is not listed
+    size_t getTaskOutputBytesAtPoint(long t, long point) const;
+
 private:
+    std::unordered_map<std::string, size_t> taskType2outputBytes;
+
     bool validate();
 };
 
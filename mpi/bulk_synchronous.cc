@@ -13,14 +13,94 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <tuple>
 
 #include "core.h"
 
 #include "mpi.h"
 
+// Both sides of every rank pair post their messages in (to, from) order,
+// so MPI's non-overtaking rule matches them and the tag does not need to
+// encode any points. Persistent requests are therefore started one at a
+// time in that order rather than with MPI_Startall.
+static const int MESSAGE_TAG = 0;
+
+struct Message {
+  int rank; // peer
+  long to;
+  long from;
+  long slot; // input index of the receiving point
+
+  bool operator<(const Message &other) const
+  {
+    return std::tie(rank, to, from) < std::tie(other.rank, other.to, other.from);
+  }
+};
+
+// Under -aggregate, everything one rank pair exchanges in a timestep:
+// each distinct source point's output once, in point order.
+struct Bundle {
+  int rank; // peer
+  std::vector<long> points;
+  std::vector<char> buffer; // points.size() outputs of output_bytes_per_task
+};
+
+// Messages exchanged by one communication pattern, in posting order.
+struct CommPlan {
+  std::vector<Message> recvs;
+  std::vector<Message> sends;
+  std::vector<MPI_Request> requests; // under -persistent
+
+  // Under -aggregate. unpack[i] locates recvs[i] as (bundle, byte offset).
+  std::vector<Bundle> recv_bundles;
+  std::vector<Bundle> send_bundles;
+  std::vector<std::pair<size_t, size_t> > unpack;
+
+  // Under -shared-memory, node ranks this rank reads outputs from and
+  // whose outputs it reads.
+  std::vector<int> node_sources;
+  std::vector<int> node_dests;
+};
+
+// Under -shared-memory, the segment of each rank starts with the number
+// of timesteps it has completed, followed by its outputs.
+static std::atomic<long> *done_flag(char *segment)
+{
+  return reinterpret_cast<std::atomic<long> *>(segment);
+}
+
+static void wait_done(char *segment, long timestep)
+{
+  while (done_flag(segment)->load(std::memory_order_acquire) < timestep);
+}
+
+// Groups messages (sorted by rank) into one bundle per peer.
+static std::vector<Bundle> make_bundles(const std::vector<Message> &messages, size_t bytes)
+{
+  std::vector<Bundle> bundles;
+  for (auto &m : messages) {
+    if (bundles.empty() || bundles.back().rank != m.rank) {
+      bundles.push_back(Bundle{m.rank, std::vector<long>(), std::vector<char>()});
+    }
+    bundles.back().points.push_back(m.from);
+  }
+  for (auto &bundle : bundles) {
+    std::sort(bundle.points.begin(), bundle.points.end());
+    bundle.points.erase(std::unique(bundle.points.begin(), bundle.points.end()), bundle.points.end());
+    bundle.buffer.resize(bundle.points.size() * bytes);
+  }
+  return bundles;
+}
+
 int main(int argc, char *argv[])
 {
   MPI_Init(&argc, &argv);
@@ -31,16 +111,59 @@ int main(int argc, char *argv[])
   App app(argc, argv);
   if (rank == 0) app.display();
 
-  std::vector<std::vector<char> > scratch;
-  for (auto graph : app.graphs) {
-    long first_point = rank * graph.max_width / n_ranks;
-    long last_point = (rank + 1) * graph.max_width / n_ranks - 1;
-    long n_points = last_point - first_point + 1;
+  // Create persistent requests once per distinct communication pattern
+  // and only start them each timestep.
+  bool persistent = false;
+  // Send one message per peer rank and timestep instead of one per
+  // (point, dependent) pair.
+  bool aggregate = false;
+  // Pass on-node inputs as pointers into double-buffered outputs instead
+  // of copying them; only remote inputs get receive buffers.
+  bool zero_copy = false;
+  // Read outputs of ranks on the same node straight out of an
+  // MPI_Win_allocate_shared window instead of exchanging messages.
+  bool shared_memory = false;
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-persistent")) {
+      persistent = true;
+    }
+    if (!strcmp(argv[k], "-aggregate")) {
+      aggregate = true;
+    }
+    if (!strcmp(argv[k], "-zero-copy")) {
+      zero_copy = true;
+    }
+    if (!strcmp(argv[k], "-shared-memory")) {
+      shared_memory = true;
+    }
+  }
 
-    size_t scratch_bytes = graph.scratch_bytes_per_task;
-    scratch.emplace_back(scratch_bytes * n_points);
-    TaskGraph::prepare_scratch(scratch.back().data(), scratch.back().size());
+  // Rank of every world rank within this node, or MPI_UNDEFINED.
+  MPI_Comm node_comm;
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+  std::vector<int> node_rank_of(n_ranks);
+  {
+    MPI_Group world_group, node_group;
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Comm_group(node_comm, &node_group);
+    std::vector<int> world_ranks(n_ranks);
+    for (int r = 0; r < n_ranks; ++r) {
+      world_ranks[r] = r;
+    }
+    MPI_Group_translate_ranks(world_group, n_ranks, world_ranks.data(), node_group, node_rank_of.data());
+    MPI_Group_free(&world_group);
+    MPI_Group_free(&node_group);
   }
+  auto on_node = [&](int peer) {
+    return shared_memory && node_rank_of[peer] != MPI_UNDEFINED;
+  };
+
+  // Outputs are double-buffered whenever another point may read them in
+  // place while this timestep writes its own.
+  bool double_buffer = zero_copy || shared_memory;
+
+  ScratchManager scratch(app, 1, SCRATCH_PER_POINT, rank, n_ranks);
+  scratch.prepare_worker(0);
 
   double elapsed_time = 0.0;
   for (int iter = 0; iter < 2; ++iter) {
@@ -56,39 +179,67 @@ int main(int argc, char *argv[])
       long n_points = last_point - first_point + 1;
 
       size_t scratch_bytes = graph.scratch_bytes_per_task;
-      char *scratch_ptr = scratch[graph.graph_index].data();
-
-      std::vector<int> rank_by_point(graph.max_width);
-      std::vector<int> tag_bits_by_point(graph.max_width);
-      for (int r = 0; r < n_ranks; ++r) {
-        long r_first_point = r * graph.max_width / n_ranks;
-        long r_last_point = (r + 1) * graph.max_width / n_ranks - 1;
-        for (long p = r_first_point; p <= r_last_point; ++p) {
-          rank_by_point[p] = r;
-          tag_bits_by_point[p] = p - r_first_point;
-          // Has to fit in 7 bits because MPI only guarrantees that
-          // tags can use 15 bits.
-          assert((tag_bits_by_point[p] & ~0x7F) == 0);
-        }
-      }
+      BoundTaskGraph bound = graph.bind();
+
+      // Inverse of the block distribution above.
+      auto owner = [&](long point) {
+        return (int)(((point + 1) * n_ranks - 1) / graph.max_width);
+      };
 
       long max_deps = 0;
+      std::vector<long> max_remote_deps(n_points);
       for (long dset = 0; dset < graph.max_dependence_sets(); ++dset) {
         for (long point = first_point; point <= last_point; ++point) {
-          long deps = 0;
+          long deps = 0, remote_deps = 0;
           for (auto interval : graph.dependencies(dset, point)) {
+            long local = std::min(interval.second, last_point) - std::max(interval.first, first_point) + 1;
             deps += interval.second - interval.first + 1;
+            remote_deps += interval.second - interval.first + 1 - std::max(local, 0L);
           }
           max_deps = std::max(max_deps, deps);
+          long &point_max = max_remote_deps[point - first_point];
+          point_max = std::max(point_max, remote_deps);
         }
       }
 
-      // Create input and output buffers.
+      // Create input and output buffers. Under -zero-copy and
+      // -shared-memory, outputs alternate between two buffers by timestep
+      // parity so that timestep t can read t-1's outputs in place while
+      // writing its own.
       std::vector<std::vector<std::vector<char> > > inputs(n_points);
       std::vector<std::vector<const char *> > input_ptr(n_points);
       std::vector<std::vector<size_t> > input_bytes(n_points);
       std::vector<long> n_inputs(n_points);
-      std::vector<std::vector<char> > outputs(n_points);
+      size_t output_bytes = graph.output_bytes_per_task;
+      long n_buffers = double_buffer ? 2 : 1;
+      std::vector<char> output_storage;
+      MPI_Win win = MPI_WIN_NULL;
+      std::vector<char *> segments; // by node rank
+      char *segment = NULL;
+      char *output_buffers;
+      if (shared_memory) {
+        int node_size, node_rank;
+        MPI_Comm_size(node_comm, &node_size);
+        MPI_Comm_rank(node_comm, &node_rank);
+
+        MPI_Win_allocate_shared(TASK_BENCH_CACHE_LINE + n_buffers * n_points * output_bytes, 1,
+                                MPI_INFO_NULL, node_comm, &segment, &win);
+        segments.resize(node_size);
+        for (int r = 0; r < node_size; ++r) {
+          MPI_Aint size;
+          int disp_unit;
+          MPI_Win_shared_query(win, r, &size, &disp_unit, &segments[r]);
+        }
+        output_buffers = segment + TASK_BENCH_CACHE_LINE;
+        new (done_flag(segment)) std::atomic<long>(0);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+        MPI_Barrier(node_comm);
+      } else {
+        output_storage.resize(n_buffers * n_points * output_bytes);
+        output_buffers = output_storage.data();
+      }
+      std::vector<int> last_node_dests;
+
       for (long point = first_point; point <= last_point; ++point) {
         long point_index = point - first_point;
 
@@ -96,18 +247,19 @@ int main(int argc, char *argv[])
         auto &point_input_ptr = input_ptr[point_index];
         auto &point_input_bytes = input_bytes[point_index];
 
-        point_inputs.resize(max_deps);
+        long n_buffers = zero_copy ? max_remote_deps[point_index] : max_deps;
+        point_inputs.resize(n_buffers);
         point_input_ptr.resize(max_deps);
         point_input_bytes.resize(max_deps);
 
         for (long dep = 0; dep < max_deps; ++dep) {
-          point_inputs[dep].resize(graph.output_bytes_per_task);
-          point_input_ptr[dep] = point_inputs[dep].data();
-          point_input_bytes[dep] = point_inputs[dep].size();
+          if (dep < n_buffers) {
+            point_inputs[dep].resize(graph.output_bytes_per_task);
+            point_input_ptr[dep] = point_inputs[dep].data();
+          }
+          point_input_bytes[dep] = graph.output_bytes_per_task;
         }
 
-        auto &point_outputs = outputs[point_index];
-        point_outputs.resize(graph.output_bytes_per_task);
       }
 
       // Cache dependencies.
@@ -125,6 +277,11 @@ int main(int argc, char *argv[])
         }
       }
 
+      // Plans, keyed by everything that determines which messages a
+      // timestep exchanges. Once offset and width settle, this is one
+      // plan per dependence set.
+      std::map<std::array<long, 6>, CommPlan> plans;
+
       for (long timestep = 0; timestep < graph.timesteps; ++timestep) {
         long offset = graph.offset_at_timestep(timestep);
         long width = graph.width_at_timestep(timestep);
@@ -136,20 +293,34 @@ int main(int argc, char *argv[])
         auto &deps = dependencies[dset];
         auto &rev_deps = reverse_dependencies[dset];
 
-        requests.clear();
+        // Outputs of timestep-1 and buffer for this timestep's outputs.
+        long last_parity = double_buffer ? (timestep + 1) % 2 : 0;
+        char *last_outputs = output_buffers + last_parity * n_points * output_bytes;
+        char *outputs = output_buffers + (double_buffer ? timestep % 2 : 0) * n_points * output_bytes;
+
+        // Persistent sends are bound to an output buffer, so with double
+        // buffering the parity is part of the pattern.
+        std::array<long, 6> key = {{dset, offset, width, last_offset, last_width, double_buffer && persistent ? timestep % 2 : 0}};
+        bool create = plans.find(key) == plans.end();
+        if (create && !persistent) {
+          // Without persistent requests only the current plan is reused.
+          plans.clear();
+        }
+        CommPlan &plan = plans[key];
 
         for (long point = first_point; point <= last_point; ++point) {
           long point_index = point - first_point;
 
           auto &point_inputs = inputs[point_index];
+          auto &point_input_ptr = input_ptr[point_index];
           auto &point_n_inputs = n_inputs[point_index];
-          auto &point_output = outputs[point_index];
 
           auto &point_deps = deps[point_index];
           auto &point_rev_deps = rev_deps[point_index];
 
           /* Receive */
           point_n_inputs = 0;
+          long n_remote = 0;
           if (point >= offset && point < offset + width) {
             for (auto interval : point_deps) {
               for (long dep = interval.first; dep <= interval.second; ++dep) {
@@ -158,18 +329,28 @@ int main(int argc, char *argv[])
                 }
 
                 // Use shared memory for on-node data.
-                if (first_point <= dep && dep <= last_point) {
-                  auto &output = outputs[dep - first_point];
-                  point_inputs[point_n_inputs].assign(output.begin(), output.end());
+                bool local = first_point <= dep && dep <= last_point;
+                int dep_rank = owner(dep);
+                if (local && zero_copy) {
+                  point_input_ptr[point_n_inputs] = last_outputs + (dep - first_point) * output_bytes;
+                } else if (local) {
+                  memcpy(point_inputs[point_n_inputs].data(), last_outputs + (dep - first_point) * output_bytes, output_bytes);
+                  point_input_ptr[point_n_inputs] = point_inputs[point_n_inputs].data();
+                } else if (on_node(dep_rank)) {
+                  long dep_first = dep_rank * graph.max_width / n_ranks;
+                  long dep_n_points = (dep_rank + 1) * graph.max_width / n_ranks - dep_first;
+                  char *dep_outputs = segments[node_rank_of[dep_rank]] + TASK_BENCH_CACHE_LINE;
+                  point_input_ptr[point_n_inputs] =
+                    dep_outputs + (last_parity * dep_n_points + dep - dep_first) * output_bytes;
+                  if (create) {
+                    plan.node_sources.push_back(node_rank_of[dep_rank]);
+                  }
                 } else {
-                  int from = tag_bits_by_point[dep];
-                  int to = tag_bits_by_point[point];
-                  int tag = (from << 8) | to;
-                  MPI_Request req;
-                  MPI_Irecv(point_inputs[point_n_inputs].data(),
-                            point_inputs[point_n_inputs].size(), MPI_BYTE,
-                            rank_by_point[dep], tag, MPI_COMM_WORLD, &req);
-                  requests.push_back(req);
+                  long slot = zero_copy ? n_remote++ : point_n_inputs;
+                  point_input_ptr[point_n_inputs] = point_inputs[slot].data();
+                  if (create) {
+                    plan.recvs.push_back(Message{dep_rank, point, dep, slot});
+                  }
                 }
                 point_n_inputs++;
               }
@@ -177,43 +358,179 @@ int main(int argc, char *argv[])
           }
 
           /* Send */
-          if (point >= last_offset && point < last_offset + last_width) {
+          if (create && point >= last_offset && point < last_offset + last_width) {
             for (auto interval : point_rev_deps) {
               for (long dep = interval.first; dep <= interval.second; dep++) {
                 if (dep < offset || dep >= offset + width || (first_point <= dep && dep <= last_point)) {
                   continue;
                 }
 
-                int from = tag_bits_by_point[point];
-                int to = tag_bits_by_point[dep];
-                int tag = (from << 8) | to;
-                MPI_Request req;
-                MPI_Isend(point_output.data(), point_output.size(), MPI_BYTE,
-                          rank_by_point[dep], tag, MPI_COMM_WORLD, &req);
-                requests.push_back(req);
+                if (on_node(owner(dep))) {
+                  plan.node_dests.push_back(node_rank_of[owner(dep)]);
+                  continue;
+                }
+
+                plan.sends.push_back(Message{owner(dep), dep, point, 0});
               }
             }
           }
         }
 
-        MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+        if (create) {
+          std::sort(plan.recvs.begin(), plan.recvs.end());
+          std::sort(plan.sends.begin(), plan.sends.end());
+
+          for (auto ranks : {&plan.node_sources, &plan.node_dests}) {
+            std::sort(ranks->begin(), ranks->end());
+            ranks->erase(std::unique(ranks->begin(), ranks->end()), ranks->end());
+          }
+
+          if (aggregate) {
+            plan.recv_bundles = make_bundles(plan.recvs, output_bytes);
+            plan.send_bundles = make_bundles(plan.sends, output_bytes);
+            size_t b = 0;
+            for (auto &m : plan.recvs) {
+              while (plan.recv_bundles[b].rank != m.rank) b++;
+              auto &points = plan.recv_bundles[b].points;
+              size_t k = std::lower_bound(points.begin(), points.end(), m.from) - points.begin();
+              plan.unpack.push_back(std::make_pair(b, k * output_bytes));
+            }
+          }
+        }
+
+        if (aggregate) {
+          for (auto &bundle : plan.send_bundles) {
+            for (size_t k = 0; k < bundle.points.size(); ++k) {
+              memcpy(bundle.buffer.data() + k * output_bytes,
+                     last_outputs + (bundle.points[k] - first_point) * output_bytes, output_bytes);
+            }
+          }
+        }
+
+        if (persistent) {
+          if (create) {
+            MPI_Request req;
+            if (aggregate) {
+              for (auto &bundle : plan.recv_bundles) {
+                MPI_Recv_init(bundle.buffer.data(), bundle.buffer.size(), MPI_BYTE,
+                              bundle.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+                plan.requests.push_back(req);
+              }
+              for (auto &bundle : plan.send_bundles) {
+                MPI_Send_init(bundle.buffer.data(), bundle.buffer.size(), MPI_BYTE,
+                              bundle.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+                plan.requests.push_back(req);
+              }
+            } else {
+              for (auto &m : plan.recvs) {
+                auto &input = inputs[m.to - first_point][m.slot];
+                MPI_Recv_init(input.data(), input.size(), MPI_BYTE,
+                              m.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+                plan.requests.push_back(req);
+              }
+              for (auto &m : plan.sends) {
+                // The count is fixed at creation, so send the whole
+                // buffer even when output sizes vary by timestep.
+                MPI_Send_init(last_outputs + (m.from - first_point) * output_bytes, output_bytes, MPI_BYTE,
+                              m.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+                plan.requests.push_back(req);
+              }
+            }
+          }
+          // In list order, not MPI_Startall (see MESSAGE_TAG).
+          for (auto &r : plan.requests) {
+            MPI_Start(&r);
+          }
+          MPI_Waitall(plan.requests.size(), plan.requests.data(), MPI_STATUSES_IGNORE);
+        } else {
+          requests.clear();
+          MPI_Request req;
+          if (aggregate) {
+            for (auto &bundle : plan.recv_bundles) {
+              MPI_Irecv(bundle.buffer.data(), bundle.buffer.size(), MPI_BYTE,
+                        bundle.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+              requests.push_back(req);
+            }
+            for (auto &bundle : plan.send_bundles) {
+              MPI_Isend(bundle.buffer.data(), bundle.buffer.size(), MPI_BYTE,
+                        bundle.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+              requests.push_back(req);
+            }
+          } else {
+            for (auto &m : plan.recvs) {
+              auto &input = inputs[m.to - first_point][m.slot];
+              MPI_Irecv(input.data(), input.size(), MPI_BYTE,
+                        m.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+              requests.push_back(req);
+            }
+            for (auto &m : plan.sends) {
+              MPI_Isend(last_outputs + (m.from - first_point) * output_bytes, graph.output_bytes_at_point(timestep-1, m.from), MPI_BYTE,
+                        m.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+              requests.push_back(req);
+            }
+          }
+          MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+        }
 
         MPI_Barrier(MPI_COMM_WORLD);
 
+        if (aggregate) {
+          for (size_t i = 0; i < plan.recvs.size(); ++i) {
+            auto &m = plan.recvs[i];
+            auto &bundle = plan.recv_bundles[plan.unpack[i].first];
+            memcpy(inputs[m.to - first_point][m.slot].data(),
+                   bundle.buffer.data() + plan.unpack[i].second, output_bytes);
+          }
+        }
+
+        if (shared_memory) {
+          // On-node producers must have finished timestep-1, and the
+          // readers of timestep-2's outputs (overwritten below) must be
+          // done with them.
+          for (int r : plan.node_sources) {
+            wait_done(segments[r], timestep);
+          }
+          for (int r : last_node_dests) {
+            wait_done(segments[r], timestep);
+          }
+          MPI_Win_sync(win);
+        }
+
         for (long point = std::max(first_point, offset); point <= std::min(last_point, offset + width - 1); ++point) {
           long point_index = point - first_point;
 
           auto &point_input_ptr = input_ptr[point_index];
           auto &point_input_bytes = input_bytes[point_index];
           auto &point_n_inputs = n_inputs[point_index];
-          auto &point_output = outputs[point_index];
+          char *point_output = outputs + point_index * output_bytes;
 
-          graph.execute_point(timestep, point,
-                              point_output.data(), point_output.size(),
+          char *scratch_ptr = scratch.acquire(0, graph.graph_index, timestep, point);
+          bound.execute_point(timestep, point,
+                              point_output, output_bytes,
                               point_input_ptr.data(), point_input_bytes.data(), point_n_inputs,
-                              scratch_ptr + scratch_bytes * point_index, scratch_bytes);
+                              scratch_ptr, scratch_bytes);
+          scratch.release(scratch_ptr);
+        }
+
+        if (shared_memory) {
+          MPI_Win_sync(win);
+          done_flag(segment)->store(timestep + 1, std::memory_order_release);
+          last_node_dests = plan.node_dests;
         }
       }
+
+      for (auto &entry : plans) {
+        for (auto &req : entry.second.requests) {
+          MPI_Request_free(&req);
+        }
+      }
+
+      if (shared_memory) {
+        // Peers may still be reading the last timestep's outputs.
+        MPI_Barrier(node_comm);
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+      }
     }
 
     MPI_Barrier(MPI_COMM_WORLD);
@@ -226,5 +543,7 @@ int main(int argc, char *argv[])
     app.report_timing(elapsed_time);
   }
 
+  MPI_Comm_free(&node_comm);
+
   MPI_Finalize();
 }
@@ -0,0 +1,352 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compute-as-ready variant of nonblock.cc. Within a timestep, a point
+// executes as soon as its remote inputs have arrived (MPI_Testsome /
+// MPI_Waitsome) and sends its output to the next timestep's consumers
+// immediately after, so communication overlaps with the computation of
+// the rank's other points. Outputs are double-buffered by timestep
+// parity: sends of timestep t only have to complete before t+2 writes
+// the same buffer.
+//
+// Because sends are issued in execution order, messages cannot be
+// matched by posting order as in nonblock.cc. Each output is sent once
+// per consuming rank, tagged with its source point.
+//
+// With -progress-thread, a dedicated thread polls MPI (under
+// MPI_THREAD_MULTIPLE) so that transfers advance while the main thread
+// is inside a kernel.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <utility>
+
+#include "core.h"
+
+#include "mpi.h"
+
+// One message received per timestep: the output of a remote point,
+// shared by all local points that depend on it.
+struct Recv {
+  int rank; // peer
+  long from;
+  std::vector<std::pair<long, long> > consumers; // (point index, input index)
+  std::vector<char> buffer;
+};
+
+// Everything a timestep with a given communication pattern needs.
+struct DataflowPlan {
+  std::vector<Recv> recvs;
+  std::vector<long> pending; // remote inputs per point index
+  std::vector<long> n_inputs; // per point index
+  std::vector<std::array<long, 3> > local; // (point index, input index, source point index)
+  std::vector<std::vector<int> > dests; // per point index: ranks that consume its last output
+};
+
+int main(int argc, char *argv[])
+{
+  // Needed before MPI_Init_thread, so parse it ahead of App.
+  bool progress_thread = false;
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-progress-thread")) {
+      progress_thread = true;
+    }
+  }
+
+  int required = progress_thread ? MPI_THREAD_MULTIPLE : MPI_THREAD_SINGLE;
+  int provided;
+  MPI_Init_thread(&argc, &argv, required, &provided);
+  if (provided < required) {
+    fprintf(stderr, "error: \"-progress-thread\" requires MPI_THREAD_MULTIPLE\n");
+    abort();
+  }
+
+  int n_ranks, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  App app(argc, argv);
+  if (rank == 0) app.display();
+
+  int *tag_ub, has_tag_ub;
+  MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &tag_ub, &has_tag_ub);
+  assert(has_tag_ub);
+  for (auto graph : app.graphs) {
+    if (graph.max_width - 1 > *tag_ub) {
+      fprintf(stderr, "error: Graph width %ld exceeds MPI_TAG_UB (%d)\n", graph.max_width, *tag_ub);
+      abort();
+    }
+  }
+
+  // The progress thread only probes a communicator of its own, so it
+  // never interferes with the benchmark's messages.
+  MPI_Comm progress_comm;
+  MPI_Comm_dup(MPI_COMM_WORLD, &progress_comm);
+  std::atomic<bool> stop_progress(false);
+  std::thread progress;
+  if (progress_thread) {
+    progress = std::thread([&]() {
+      while (!stop_progress.load(std::memory_order_relaxed)) {
+        int flag;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, progress_comm, &flag, MPI_STATUS_IGNORE);
+      }
+    });
+  }
+
+  ScratchManager scratch(app, 1, SCRATCH_PER_POINT, rank, n_ranks);
+  scratch.prepare_worker(0);
+
+  double elapsed_time = 0.0;
+  for (int iter = 0; iter < 2; ++iter) {
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    double start_time = MPI_Wtime();
+
+    std::vector<MPI_Request> recv_requests;
+    std::vector<int> completed;
+    std::vector<long> pending;
+    std::vector<long> ready;
+    std::vector<MPI_Request> send_requests[2]; // by timestep parity
+
+    for (auto graph : app.graphs) {
+      long first_point = rank * graph.max_width / n_ranks;
+      long last_point = (rank + 1) * graph.max_width / n_ranks - 1;
+      long n_points = last_point - first_point + 1;
+
+      size_t scratch_bytes = graph.scratch_bytes_per_task;
+      size_t output_bytes = graph.output_bytes_per_task;
+      BoundTaskGraph bound = graph.bind();
+
+      // Inverse of the block distribution above.
+      auto owner = [&](long point) {
+        return (int)(((point + 1) * n_ranks - 1) / graph.max_width);
+      };
+
+      long max_deps = 0;
+      for (long dset = 0; dset < graph.max_dependence_sets(); ++dset) {
+        for (long point = first_point; point <= last_point; ++point) {
+          long deps = 0;
+          for (auto interval : graph.dependencies(dset, point)) {
+            deps += interval.second - interval.first + 1;
+          }
+          max_deps = std::max(max_deps, deps);
+        }
+      }
+
+      // Inputs are pointers into either the receive buffers or the
+      // previous timestep's outputs.
+      std::vector<std::vector<const char *> > input_ptr(n_points);
+      std::vector<std::vector<size_t> > input_bytes(n_points);
+      std::vector<std::vector<char> > outputs[2];
+      for (long point_index = 0; point_index < n_points; ++point_index) {
+        input_ptr[point_index].resize(max_deps);
+        input_bytes[point_index].assign(max_deps, output_bytes);
+      }
+      for (auto &buffer : outputs) {
+        buffer.resize(n_points);
+        for (auto &output : buffer) {
+          output.resize(output_bytes);
+        }
+      }
+
+      // Plans, keyed by everything that determines which messages a
+      // timestep exchanges.
+      std::map<std::array<long, 5>, DataflowPlan> plans;
+      auto plan_at = [&](long timestep) -> DataflowPlan & {
+        long offset = graph.offset_at_timestep(timestep);
+        long width = graph.width_at_timestep(timestep);
+
+        long last_offset = graph.offset_at_timestep(timestep-1);
+        long last_width = graph.width_at_timestep(timestep-1);
+
+        long dset = graph.dependence_set_at_timestep(timestep);
+
+        std::array<long, 5> key = {{dset, offset, width, last_offset, last_width}};
+        auto it = plans.find(key);
+        if (it != plans.end()) {
+          return it->second;
+        }
+
+        DataflowPlan &plan = plans[key];
+        plan.pending.assign(n_points, 0);
+        plan.n_inputs.assign(n_points, 0);
+        plan.dests.resize(n_points);
+
+        std::map<std::pair<int, long>, size_t> recv_index;
+        for (long point = first_point; point <= last_point; ++point) {
+          long point_index = point - first_point;
+
+          /* Receive */
+          if (point >= offset && point < offset + width) {
+            long n_inputs = 0;
+            for (auto interval : graph.dependencies(dset, point)) {
+              for (long dep = interval.first; dep <= interval.second; ++dep) {
+                if (dep < last_offset || dep >= last_offset + last_width) {
+                  continue;
+                }
+
+                if (first_point <= dep && dep <= last_point) {
+                  plan.local.push_back({{point_index, n_inputs, dep - first_point}});
+                } else {
+                  auto source = std::make_pair(owner(dep), dep);
+                  auto found = recv_index.find(source);
+                  if (found == recv_index.end()) {
+                    found = recv_index.insert(std::make_pair(source, plan.recvs.size())).first;
+                    plan.recvs.push_back(Recv{source.first, dep, {}, std::vector<char>(output_bytes)});
+                  }
+                  plan.recvs[found->second].consumers.push_back(std::make_pair(point_index, n_inputs));
+                  plan.pending[point_index]++;
+                }
+                n_inputs++;
+              }
+            }
+            plan.n_inputs[point_index] = n_inputs;
+          }
+
+          /* Send */
+          if (point >= last_offset && point < last_offset + last_width) {
+            auto &dests = plan.dests[point_index];
+            for (auto interval : graph.reverse_dependencies(dset, point)) {
+              for (long dep = interval.first; dep <= interval.second; dep++) {
+                if (dep < offset || dep >= offset + width || (first_point <= dep && dep <= last_point)) {
+                  continue;
+                }
+
+                dests.push_back(owner(dep));
+              }
+            }
+            std::sort(dests.begin(), dests.end());
+            dests.erase(std::unique(dests.begin(), dests.end()), dests.end());
+          }
+        }
+        return plan;
+      };
+
+      for (long timestep = 0; timestep < graph.timesteps; ++timestep) {
+        long offset = graph.offset_at_timestep(timestep);
+        long width = graph.width_at_timestep(timestep);
+
+        DataflowPlan &plan = plan_at(timestep);
+        DataflowPlan *next_plan = timestep + 1 < graph.timesteps ? &plan_at(timestep + 1) : NULL;
+
+        auto &last_outputs = outputs[(timestep + 1) % 2];
+        auto &next_outputs = outputs[timestep % 2];
+
+        // Sends of timestep-2 read the buffers this timestep writes.
+        auto &sends = send_requests[timestep % 2];
+        MPI_Waitall(sends.size(), sends.data(), MPI_STATUSES_IGNORE);
+        sends.clear();
+
+        recv_requests.resize(plan.recvs.size());
+        for (size_t i = 0; i < plan.recvs.size(); ++i) {
+          auto &recv = plan.recvs[i];
+          MPI_Irecv(recv.buffer.data(), recv.buffer.size(), MPI_BYTE,
+                    recv.rank, recv.from, MPI_COMM_WORLD, &recv_requests[i]);
+          for (auto &consumer : recv.consumers) {
+            input_ptr[consumer.first][consumer.second] = recv.buffer.data();
+          }
+        }
+        for (auto &local : plan.local) {
+          input_ptr[local[0]][local[1]] = last_outputs[local[2]].data();
+        }
+
+        pending = plan.pending;
+        ready.clear();
+        for (long point = std::max(first_point, offset); point <= std::min(last_point, offset + width - 1); ++point) {
+          if (pending[point - first_point] == 0) {
+            ready.push_back(point - first_point);
+          }
+        }
+
+        completed.resize(plan.recvs.size());
+        size_t n_completed = 0;
+        size_t next_ready = 0;
+        while (next_ready < ready.size() || n_completed < plan.recvs.size()) {
+          // Release points whose last remote input has arrived. Only
+          // block when there is nothing else to do.
+          if (n_completed < plan.recvs.size()) {
+            int n_done;
+            if (next_ready < ready.size()) {
+              MPI_Testsome(recv_requests.size(), recv_requests.data(), &n_done, completed.data(), MPI_STATUSES_IGNORE);
+            } else {
+              MPI_Waitsome(recv_requests.size(), recv_requests.data(), &n_done, completed.data(), MPI_STATUSES_IGNORE);
+            }
+            assert(n_done != MPI_UNDEFINED);
+            n_completed += n_done;
+            for (int k = 0; k < n_done; ++k) {
+              for (auto &consumer : plan.recvs[completed[k]].consumers) {
+                if (--pending[consumer.first] == 0) {
+                  ready.push_back(consumer.first);
+                }
+              }
+            }
+          }
+
+          if (next_ready < ready.size()) {
+            long point_index = ready[next_ready++];
+            long point = point_index + first_point;
+            auto &point_output = next_outputs[point_index];
+
+            char *scratch_ptr = scratch.acquire(0, graph.graph_index, timestep, point);
+            bound.execute_point(timestep, point,
+                                point_output.data(), point_output.size(),
+                                input_ptr[point_index].data(), input_bytes[point_index].data(),
+                                plan.n_inputs[point_index],
+                                scratch_ptr, scratch_bytes);
+            scratch.release(scratch_ptr);
+
+            if (next_plan) {
+              for (int dest : next_plan->dests[point_index]) {
+                MPI_Request req;
+                MPI_Isend(point_output.data(), graph.output_bytes_at_point(timestep, point), MPI_BYTE,
+                          dest, point, MPI_COMM_WORLD, &req);
+                sends.push_back(req);
+              }
+            }
+          }
+        }
+      }
+
+      for (auto &sends : send_requests) {
+        MPI_Waitall(sends.size(), sends.data(), MPI_STATUSES_IGNORE);
+        sends.clear();
+      }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    double stop_time = MPI_Wtime();
+    elapsed_time = stop_time - start_time;
+  }
+
+  if (rank == 0) {
+    app.report_timing(elapsed_time);
+  }
+
+  if (progress_thread) {
+    stop_progress = true;
+    progress.join();
+  }
+  MPI_Comm_free(&progress_comm);
+
+  MPI_Finalize();
+}
@@ -0,0 +1,378 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Neighborhood-collective variant of nonblock.cc. Each dependence set
+// gets a distributed graph communicator whose sources and destinations
+// are the ranks this rank exchanges data with at full width, and every
+// timestep is a single MPI_Neighbor_alltoallv on it; peers that a
+// narrower timestep does not need get zero counts. Outputs are packed
+// per destination as in nonblock -aggregate.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#include "core.h"
+
+#include "mpi.h"
+
+struct Message {
+  int rank; // peer
+  long to;
+  long from;
+  long slot; // input index of the receiving point
+
+  bool operator<(const Message &other) const
+  {
+    return std::tie(rank, to, from) < std::tie(other.rank, other.to, other.from);
+  }
+};
+
+// Buffer layout for one side of an alltoallv: for each peer, the
+// distinct source points it exchanges, in point order.
+struct Layout {
+  std::vector<int> ranks;
+  std::vector<long> points;
+  std::vector<int> counts; // bytes per peer
+  std::vector<int> displs;
+};
+
+struct NeighborPlan {
+  std::vector<Message> recvs;
+  std::vector<Message> sends;
+  Layout recv_layout;
+  Layout send_layout;
+  std::vector<size_t> unpack; // offset in recv_buffer of each recvs[i]
+  std::vector<char> recv_buffer;
+  std::vector<char> send_buffer;
+  MPI_Request request; // under -persistent
+};
+
+// Layout over the communicator's peers (sorted); peers without messages
+// get a zero count. Expects messages sorted by rank.
+static Layout make_layout(const std::vector<int> &peers, const std::vector<Message> &messages, size_t bytes)
+{
+  Layout layout;
+  layout.ranks = peers;
+  size_t i = 0;
+  for (int peer : peers) {
+    std::vector<long> points;
+    for (; i < messages.size() && messages[i].rank == peer; ++i) {
+      points.push_back(messages[i].from);
+    }
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    layout.displs.push_back(layout.points.size() * bytes);
+    layout.counts.push_back(points.size() * bytes);
+    layout.points.insert(layout.points.end(), points.begin(), points.end());
+  }
+  assert(i == messages.size());
+  return layout;
+}
+
+int main(int argc, char *argv[])
+{
+  MPI_Init(&argc, &argv);
+  int n_ranks, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  App app(argc, argv);
+  if (rank == 0) app.display();
+
+  // Use MPI-4 persistent neighborhood collectives.
+  bool persistent = false;
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-persistent")) {
+      persistent = true;
+    }
+  }
+#if MPI_VERSION < 4
+  if (persistent) {
+    fprintf(stderr, "error: \"-persistent\" requires MPI_Neighbor_alltoallv_init (MPI 4.0)\n");
+    abort();
+  }
+#endif
+
+  ScratchManager scratch(app, 1, SCRATCH_PER_POINT, rank, n_ranks);
+  scratch.prepare_worker(0);
+
+  double elapsed_time = 0.0;
+  for (int iter = 0; iter < 2; ++iter) {
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    double start_time = MPI_Wtime();
+
+    for (auto graph : app.graphs) {
+      long first_point = rank * graph.max_width / n_ranks;
+      long last_point = (rank + 1) * graph.max_width / n_ranks - 1;
+      long n_points = last_point - first_point + 1;
+
+      size_t scratch_bytes = graph.scratch_bytes_per_task;
+      size_t output_bytes = graph.output_bytes_per_task;
+      BoundTaskGraph bound = graph.bind();
+
+      // Inverse of the block distribution above.
+      auto owner = [&](long point) {
+        return (int)(((point + 1) * n_ranks - 1) / graph.max_width);
+      };
+
+      long max_deps = 0;
+      for (long dset = 0; dset < graph.max_dependence_sets(); ++dset) {
+        for (long point = first_point; point <= last_point; ++point) {
+          long deps = 0;
+          for (auto interval : graph.dependencies(dset, point)) {
+            deps += interval.second - interval.first + 1;
+          }
+          max_deps = std::max(max_deps, deps);
+        }
+      }
+
+      // Create input and output buffers.
+      std::vector<std::vector<std::vector<char> > > inputs(n_points);
+      std::vector<std::vector<const char *> > input_ptr(n_points);
+      std::vector<std::vector<size_t> > input_bytes(n_points);
+      std::vector<long> n_inputs(n_points);
+      std::vector<std::vector<char> > outputs(n_points);
+      for (long point = first_point; point <= last_point; ++point) {
+        long point_index = point - first_point;
+
+        auto &point_inputs = inputs[point_index];
+        auto &point_input_ptr = input_ptr[point_index];
+        auto &point_input_bytes = input_bytes[point_index];
+
+        point_inputs.resize(max_deps);
+        point_input_ptr.resize(max_deps);
+        point_input_bytes.resize(max_deps);
+
+        for (long dep = 0; dep < max_deps; ++dep) {
+          point_inputs[dep].resize(output_bytes);
+          point_input_ptr[dep] = point_inputs[dep].data();
+          point_input_bytes[dep] = point_inputs[dep].size();
+        }
+
+        auto &point_outputs = outputs[point_index];
+        point_outputs.resize(output_bytes);
+      }
+
+      // Cache dependencies.
+      std::vector<std::vector<std::vector<std::pair<long, long> > > > dependencies(graph.max_dependence_sets());
+      std::vector<std::vector<std::vector<std::pair<long, long> > > > reverse_dependencies(graph.max_dependence_sets());
+      for (long dset = 0; dset < graph.max_dependence_sets(); ++dset) {
+        dependencies[dset].resize(n_points);
+        reverse_dependencies[dset].resize(n_points);
+
+        for (long point = first_point; point <= last_point; ++point) {
+          long point_index = point - first_point;
+
+          dependencies[dset][point_index] = graph.dependencies(dset, point);
+          reverse_dependencies[dset][point_index] = graph.reverse_dependencies(dset, point);
+        }
+      }
+
+      // One communicator per dependence set, with the peers of the
+      // full-width pattern. Creation is collective, so every rank creates
+      // them up front in dset order. Only the number of dependence sets
+      // bounds how many are alive, whatever the width pattern.
+      std::vector<MPI_Comm> comms(graph.max_dependence_sets());
+      std::vector<std::vector<int> > sources(graph.max_dependence_sets());
+      std::vector<std::vector<int> > destinations(graph.max_dependence_sets());
+      for (long dset = 0; dset < graph.max_dependence_sets(); ++dset) {
+        for (long point = first_point; point <= last_point; ++point) {
+          long point_index = point - first_point;
+          for (auto interval : dependencies[dset][point_index]) {
+            for (long dep = interval.first; dep <= interval.second; ++dep) {
+              if (dep < first_point || dep > last_point) {
+                sources[dset].push_back(owner(dep));
+              }
+            }
+          }
+          for (auto interval : reverse_dependencies[dset][point_index]) {
+            for (long dep = interval.first; dep <= interval.second; ++dep) {
+              if (dep < first_point || dep > last_point) {
+                destinations[dset].push_back(owner(dep));
+              }
+            }
+          }
+        }
+        for (auto *peers : {&sources[dset], &destinations[dset]}) {
+          std::sort(peers->begin(), peers->end());
+          peers->erase(std::unique(peers->begin(), peers->end()), peers->end());
+        }
+
+        MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD,
+                                       sources[dset].size(), sources[dset].data(), MPI_UNWEIGHTED,
+                                       destinations[dset].size(), destinations[dset].data(), MPI_UNWEIGHTED,
+                                       MPI_INFO_NULL, 0, &comms[dset]);
+      }
+
+      // Plans, keyed by everything that determines which messages a
+      // timestep exchanges.
+      std::map<std::array<long, 5>, NeighborPlan> plans;
+
+      for (long timestep = 0; timestep < graph.timesteps; ++timestep) {
+        long offset = graph.offset_at_timestep(timestep);
+        long width = graph.width_at_timestep(timestep);
+
+        long last_offset = graph.offset_at_timestep(timestep-1);
+        long last_width = graph.width_at_timestep(timestep-1);
+
+        long dset = graph.dependence_set_at_timestep(timestep);
+        auto &deps = dependencies[dset];
+        auto &rev_deps = reverse_dependencies[dset];
+
+        std::array<long, 5> key = {{dset, offset, width, last_offset, last_width}};
+        bool create = plans.find(key) == plans.end();
+        NeighborPlan &plan = plans[key];
+
+        for (long point = first_point; point <= last_point; ++point) {
+          long point_index = point - first_point;
+
+          auto &point_inputs = inputs[point_index];
+          auto &point_n_inputs = n_inputs[point_index];
+
+          auto &point_deps = deps[point_index];
+          auto &point_rev_deps = rev_deps[point_index];
+
+          /* Receive */
+          point_n_inputs = 0;
+          if (point >= offset && point < offset + width) {
+            for (auto interval : point_deps) {
+              for (long dep = interval.first; dep <= interval.second; ++dep) {
+                if (dep < last_offset || dep >= last_offset + last_width) {
+                  continue;
+                }
+
+                // Use shared memory for on-node data.
+                if (first_point <= dep && dep <= last_point) {
+                  auto &output = outputs[dep - first_point];
+                  point_inputs[point_n_inputs].assign(output.begin(), output.end());
+                } else if (create) {
+                  plan.recvs.push_back(Message{owner(dep), point, dep, point_n_inputs});
+                }
+                point_n_inputs++;
+              }
+            }
+          }
+
+          /* Send */
+          if (create && point >= last_offset && point < last_offset + last_width) {
+            for (auto interval : point_rev_deps) {
+              for (long dep = interval.first; dep <= interval.second; dep++) {
+                if (dep < offset || dep >= offset + width || (first_point <= dep && dep <= last_point)) {
+                  continue;
+                }
+
+                plan.sends.push_back(Message{owner(dep), dep, point, 0});
+              }
+            }
+          }
+        }
+
+        if (create) {
+          std::sort(plan.recvs.begin(), plan.recvs.end());
+          std::sort(plan.sends.begin(), plan.sends.end());
+          plan.recv_layout = make_layout(sources[dset], plan.recvs, output_bytes);
+          plan.send_layout = make_layout(destinations[dset], plan.sends, output_bytes);
+          plan.recv_buffer.resize(plan.recv_layout.points.size() * output_bytes);
+          plan.send_buffer.resize(plan.send_layout.points.size() * output_bytes);
+
+          const Layout &layout = plan.recv_layout;
+          size_t peer = 0;
+          for (auto &m : plan.recvs) {
+            while (layout.ranks[peer] != m.rank) peer++;
+            auto first = layout.points.begin() + layout.displs[peer] / output_bytes;
+            auto last = first + layout.counts[peer] / output_bytes;
+            plan.unpack.push_back((std::lower_bound(first, last, m.from) - layout.points.begin()) * output_bytes);
+          }
+
+#if MPI_VERSION >= 4
+          if (persistent) {
+            MPI_Neighbor_alltoallv_init(plan.send_buffer.data(), plan.send_layout.counts.data(),
+                                        plan.send_layout.displs.data(), MPI_BYTE,
+                                        plan.recv_buffer.data(), plan.recv_layout.counts.data(),
+                                        plan.recv_layout.displs.data(), MPI_BYTE,
+                                        comms[dset], MPI_INFO_NULL, &plan.request);
+          }
+#endif
+        }
+
+        for (size_t k = 0; k < plan.send_layout.points.size(); ++k) {
+          memcpy(plan.send_buffer.data() + k * output_bytes,
+                 outputs[plan.send_layout.points[k] - first_point].data(), output_bytes);
+        }
+
+        if (persistent) {
+          MPI_Start(&plan.request);
+          MPI_Wait(&plan.request, MPI_STATUS_IGNORE);
+        } else {
+          MPI_Neighbor_alltoallv(plan.send_buffer.data(), plan.send_layout.counts.data(),
+                                 plan.send_layout.displs.data(), MPI_BYTE,
+                                 plan.recv_buffer.data(), plan.recv_layout.counts.data(),
+                                 plan.recv_layout.displs.data(), MPI_BYTE,
+                                 comms[dset]);
+        }
+
+        for (size_t i = 0; i < plan.recvs.size(); ++i) {
+          auto &m = plan.recvs[i];
+          memcpy(inputs[m.to - first_point][m.slot].data(),
+                 plan.recv_buffer.data() + plan.unpack[i], output_bytes);
+        }
+
+        for (long point = std::max(first_point, offset); point <= std::min(last_point, offset + width - 1); ++point) {
+          long point_index = point - first_point;
+
+          auto &point_input_ptr = input_ptr[point_index];
+          auto &point_input_bytes = input_bytes[point_index];
+          auto &point_n_inputs = n_inputs[point_index];
+          auto &point_output = outputs[point_index];
+
+          char *scratch_ptr = scratch.acquire(0, graph.graph_index, timestep, point);
+          bound.execute_point(timestep, point,
+                              point_output.data(), point_output.size(),
+                              point_input_ptr.data(), point_input_bytes.data(), point_n_inputs,
+                              scratch_ptr, scratch_bytes);
+          scratch.release(scratch_ptr);
+        }
+      }
+
+      if (persistent) {
+        for (auto &entry : plans) {
+          MPI_Request_free(&entry.second.request);
+        }
+      }
+      for (auto &comm : comms) {
+        MPI_Comm_free(&comm);
+      }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    double stop_time = MPI_Wtime();
+    elapsed_time = stop_time - start_time;
+  }
+
+  if (rank == 0) {
+    app.report_timing(elapsed_time);
+  }
+
+  MPI_Finalize();
+}
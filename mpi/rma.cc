@@ -0,0 +1,445 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// One-sided variant of nonblock.cc. Every rank exposes the input slots
+// of its points in a window, and producers MPI_Put their outputs straight
+// into the consumers' slots. Slots are double-buffered by timestep
+// parity, so the puts of timestep t+1 never touch what timestep t reads.
+//
+// Synchronization (-sync):
+//   fence    MPI_Win_fence after each timestep's puts
+//   pscw     post/start/complete/wait with exactly the ranks this rank
+//            exchanges data with in the timestep
+//   passive  lock_all once; a producer waits for the consumer to publish
+//            that it finished timestep t-2, puts, flushes, and then sets
+//            a per-neighbor arrival flag in the consumer's flag window
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#include "core.h"
+
+#include "mpi.h"
+
+enum SyncMode {
+  SYNC_FENCE,
+  SYNC_PSCW,
+  SYNC_PASSIVE,
+};
+
+struct Message {
+  int rank; // peer
+  long to;
+  long from;
+  long slot; // input index of the receiving point
+
+  bool operator<(const Message &other) const
+  {
+    return std::tie(rank, to, from) < std::tie(other.rank, other.to, other.from);
+  }
+};
+
+// Remote accesses of one communication pattern.
+struct RmaPlan {
+  std::vector<Message> recvs; // only used for sources
+  std::vector<Message> sends;
+  std::vector<int> sources; // sorted ranks that put into this rank
+  std::vector<int> dests; // sorted ranks this rank puts into
+  MPI_Group source_group; // under SYNC_PSCW
+  MPI_Group dest_group;
+};
+
+static std::vector<int> unique_ranks(const std::vector<Message> &messages)
+{
+  std::vector<int> ranks;
+  for (auto &m : messages) {
+    if (ranks.empty() || ranks.back() != m.rank) {
+      ranks.push_back(m.rank);
+    }
+  }
+  return ranks;
+}
+
+// Index of from among the inputs of to at timestep (the same order in
+// which the receiving rank fills its slots).
+static long input_slot(const TaskGraph &graph, long timestep, long to, long from)
+{
+  long last_offset = graph.offset_at_timestep(timestep-1);
+  long last_width = graph.width_at_timestep(timestep-1);
+  long slot = 0;
+  for (auto interval : graph.dependencies(graph.dependence_set_at_timestep(timestep), to)) {
+    for (long dep = interval.first; dep <= interval.second; ++dep) {
+      if (dep < last_offset || dep >= last_offset + last_width) {
+        continue;
+      }
+      if (dep == from) return slot;
+      slot++;
+    }
+  }
+  assert(false && "not an input");
+  return -1;
+}
+
+static long poll_flag(MPI_Win win, int rank, long index)
+{
+  long value;
+  MPI_Fetch_and_op(NULL, &value, MPI_LONG, rank, index, MPI_NO_OP, win);
+  MPI_Win_flush(rank, win);
+  return value;
+}
+
+static void set_flag(MPI_Win win, int rank, long index, long value)
+{
+  MPI_Accumulate(&value, 1, MPI_LONG, rank, index, 1, MPI_LONG, MPI_REPLACE, win);
+}
+
+int main(int argc, char *argv[])
+{
+  MPI_Init(&argc, &argv);
+  int n_ranks, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  App app(argc, argv);
+  if (rank == 0) app.display();
+
+  SyncMode sync = SYNC_FENCE;
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-sync")) {
+      const char *name = argv[++k];
+      if (!strcmp(name, "fence")) {
+        sync = SYNC_FENCE;
+      } else if (!strcmp(name, "pscw")) {
+        sync = SYNC_PSCW;
+      } else if (!strcmp(name, "passive")) {
+        sync = SYNC_PASSIVE;
+      } else {
+        fprintf(stderr, "error: Invalid flag \"-sync %s\" must be fence, pscw or passive\n", name);
+        abort();
+      }
+    }
+  }
+
+  ScratchManager scratch(app, 1, SCRATCH_PER_POINT, rank, n_ranks);
+  scratch.prepare_worker(0);
+
+  MPI_Group world_group;
+  MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+
+  double elapsed_time = 0.0;
+  for (int iter = 0; iter < 2; ++iter) {
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    double start_time = MPI_Wtime();
+
+    for (auto graph : app.graphs) {
+      long first_point = rank * graph.max_width / n_ranks;
+      long last_point = (rank + 1) * graph.max_width / n_ranks - 1;
+      long n_points = last_point - first_point + 1;
+
+      size_t scratch_bytes = graph.scratch_bytes_per_task;
+      size_t output_bytes = graph.output_bytes_per_task;
+      BoundTaskGraph bound = graph.bind();
+
+      // Inverse of the block distribution above.
+      auto owner = [&](long point) {
+        return (int)(((point + 1) * n_ranks - 1) / graph.max_width);
+      };
+
+      // Producers compute remote displacements, so every rank uses the
+      // same number of slots per point.
+      long max_deps = 0;
+      for (long dset = 0; dset < graph.max_dependence_sets(); ++dset) {
+        for (long point = first_point; point <= last_point; ++point) {
+          long deps = 0;
+          for (auto interval : graph.dependencies(dset, point)) {
+            deps += interval.second - interval.first + 1;
+          }
+          max_deps = std::max(max_deps, deps);
+        }
+      }
+      MPI_Allreduce(MPI_IN_PLACE, &max_deps, 1, MPI_LONG, MPI_MAX, MPI_COMM_WORLD);
+
+      // Displacement of an input slot in the window of the owner of to.
+      auto displacement = [&](long to, long slot, long parity) {
+        long owner_points = (owner(to) + 1) * graph.max_width / n_ranks - owner(to) * graph.max_width / n_ranks;
+        long owner_first = owner(to) * graph.max_width / n_ranks;
+        return (MPI_Aint)(((parity * owner_points + to - owner_first) * max_deps + slot) * output_bytes);
+      };
+
+      // Input slots: parity x point x slot.
+      char *slots;
+      MPI_Win win;
+      MPI_Win_allocate(2 * n_points * max_deps * output_bytes, 1, MPI_INFO_NULL,
+                       MPI_COMM_WORLD, &slots, &win);
+
+      std::vector<std::vector<const char *> > input_ptr[2];
+      std::vector<std::vector<size_t> > input_bytes(n_points);
+      std::vector<long> n_inputs(n_points);
+      std::vector<std::vector<char> > outputs(n_points);
+      for (long parity = 0; parity < 2; ++parity) {
+        input_ptr[parity].resize(n_points);
+        for (long point_index = 0; point_index < n_points; ++point_index) {
+          for (long slot = 0; slot < max_deps; ++slot) {
+            input_ptr[parity][point_index].push_back(
+              slots + ((parity * n_points + point_index) * max_deps + slot) * output_bytes);
+          }
+        }
+      }
+      for (long point_index = 0; point_index < n_points; ++point_index) {
+        input_bytes[point_index].assign(max_deps, output_bytes);
+        outputs[point_index].resize(output_bytes);
+      }
+
+      // Cache dependencies.
+      std::vector<std::vector<std::vector<std::pair<long, long> > > > dependencies(graph.max_dependence_sets());
+      std::vector<std::vector<std::vector<std::pair<long, long> > > > reverse_dependencies(graph.max_dependence_sets());
+      for (long dset = 0; dset < graph.max_dependence_sets(); ++dset) {
+        dependencies[dset].resize(n_points);
+        reverse_dependencies[dset].resize(n_points);
+
+        for (long point = first_point; point <= last_point; ++point) {
+          long point_index = point - first_point;
+
+          dependencies[dset][point_index] = graph.dependencies(dset, point);
+          reverse_dependencies[dset][point_index] = graph.reverse_dependencies(dset, point);
+        }
+      }
+
+      // Plans for every pattern the graph goes through, built up front
+      // because passive synchronization needs the full neighbor set.
+      std::map<std::array<long, 5>, RmaPlan> plans;
+      std::vector<RmaPlan *> plan_at(graph.timesteps);
+      for (long timestep = 0; timestep < graph.timesteps; ++timestep) {
+        long offset = graph.offset_at_timestep(timestep);
+        long width = graph.width_at_timestep(timestep);
+        long last_offset = graph.offset_at_timestep(timestep-1);
+        long last_width = graph.width_at_timestep(timestep-1);
+        long dset = graph.dependence_set_at_timestep(timestep);
+
+        std::array<long, 5> key = {{dset, offset, width, last_offset, last_width}};
+        bool create = plans.find(key) == plans.end();
+        RmaPlan &plan = plans[key];
+        plan_at[timestep] = &plan;
+        if (!create) continue;
+
+        for (long point = first_point; point <= last_point; ++point) {
+          long point_index = point - first_point;
+
+          if (point >= offset && point < offset + width) {
+            for (auto interval : dependencies[dset][point_index]) {
+              for (long dep = interval.first; dep <= interval.second; ++dep) {
+                if (dep < last_offset || dep >= last_offset + last_width ||
+                    (first_point <= dep && dep <= last_point)) {
+                  continue;
+                }
+                plan.recvs.push_back(Message{owner(dep), point, dep, 0});
+              }
+            }
+          }
+
+          if (point >= last_offset && point < last_offset + last_width) {
+            for (auto interval : reverse_dependencies[dset][point_index]) {
+              for (long dep = interval.first; dep <= interval.second; dep++) {
+                if (dep < offset || dep >= offset + width || (first_point <= dep && dep <= last_point)) {
+                  continue;
+                }
+                plan.sends.push_back(Message{owner(dep), dep, point, input_slot(graph, timestep, dep, point)});
+              }
+            }
+          }
+        }
+
+        std::sort(plan.recvs.begin(), plan.recvs.end());
+        std::sort(plan.sends.begin(), plan.sends.end());
+        plan.sources = unique_ranks(plan.recvs);
+        plan.dests = unique_ranks(plan.sends);
+        if (sync == SYNC_PSCW) {
+          MPI_Group_incl(world_group, plan.sources.size(), plan.sources.data(), &plan.source_group);
+          MPI_Group_incl(world_group, plan.dests.size(), plan.dests.data(), &plan.dest_group);
+        }
+      }
+
+      // Passive target: per neighbor, the last timestep it finished and
+      // the last timestep whose data it delivered here. A neighbor writes
+      // at the index this rank assigned to it, learned in an exchange.
+      std::vector<int> neighbors;
+      std::map<int, long> local_index;
+      std::vector<long> remote_index;
+      long *flags = NULL;
+      MPI_Win flag_win = MPI_WIN_NULL;
+      if (sync == SYNC_PASSIVE) {
+        for (auto &entry : plans) {
+          neighbors.insert(neighbors.end(), entry.second.sources.begin(), entry.second.sources.end());
+          neighbors.insert(neighbors.end(), entry.second.dests.begin(), entry.second.dests.end());
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+        long n_neighbors = neighbors.size();
+        std::vector<long> my_index(n_neighbors);
+        remote_index.resize(n_neighbors);
+        std::vector<MPI_Request> requests;
+        for (long k = 0; k < n_neighbors; ++k) {
+          local_index[neighbors[k]] = k;
+          my_index[k] = k;
+          MPI_Request req;
+          MPI_Irecv(&remote_index[k], 1, MPI_LONG, neighbors[k], 0, MPI_COMM_WORLD, &req);
+          requests.push_back(req);
+          MPI_Isend(&my_index[k], 1, MPI_LONG, neighbors[k], 0, MPI_COMM_WORLD, &req);
+          requests.push_back(req);
+        }
+        MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+        MPI_Win_allocate(2 * n_neighbors * sizeof(long), sizeof(long), MPI_INFO_NULL,
+                         MPI_COMM_WORLD, &flags, &flag_win);
+        std::fill(flags, flags + 2 * n_neighbors, -1L);
+        MPI_Barrier(MPI_COMM_WORLD);
+        MPI_Win_lock_all(0, win);
+        MPI_Win_lock_all(0, flag_win);
+      } else if (sync == SYNC_FENCE) {
+        MPI_Win_fence(0, win);
+      }
+      // Interleaved, so a neighbor can compute the index without knowing
+      // how many neighbors this rank has.
+      long n_neighbors = neighbors.size();
+      auto done_index = [](long k) { return 2 * k; };
+      auto arrived_index = [](long k) { return 2 * k + 1; };
+
+      for (long timestep = 0; timestep < graph.timesteps; ++timestep) {
+        long offset = graph.offset_at_timestep(timestep);
+        long width = graph.width_at_timestep(timestep);
+
+        long last_offset = graph.offset_at_timestep(timestep-1);
+        long last_width = graph.width_at_timestep(timestep-1);
+
+        long dset = graph.dependence_set_at_timestep(timestep);
+        long parity = timestep % 2;
+        RmaPlan &plan = *plan_at[timestep];
+
+        if (sync == SYNC_PSCW) {
+          if (!plan.sources.empty()) MPI_Win_post(plan.source_group, 0, win);
+          if (!plan.dests.empty()) MPI_Win_start(plan.dest_group, 0, win);
+        } else if (sync == SYNC_PASSIVE) {
+          // The slots of this parity were last read at timestep-2.
+          for (int dest : plan.dests) {
+            long k = local_index[dest];
+            while (poll_flag(flag_win, rank, done_index(k)) < timestep - 2);
+          }
+        }
+
+        for (auto &m : plan.sends) {
+          MPI_Put(outputs[m.from - first_point].data(), graph.output_bytes_at_point(timestep-1, m.from), MPI_BYTE,
+                  m.rank, displacement(m.to, m.slot, parity),
+                  graph.output_bytes_at_point(timestep-1, m.from), MPI_BYTE, win);
+        }
+
+        switch (sync) {
+        case SYNC_FENCE:
+          MPI_Win_fence(0, win);
+          break;
+        case SYNC_PSCW:
+          if (!plan.dests.empty()) MPI_Win_complete(win);
+          if (!plan.sources.empty()) MPI_Win_wait(win);
+          break;
+        case SYNC_PASSIVE:
+          for (int dest : plan.dests) {
+            MPI_Win_flush(dest, win);
+            set_flag(flag_win, dest, arrived_index(remote_index[local_index[dest]]), timestep);
+          }
+          MPI_Win_flush_all(flag_win);
+          for (int source : plan.sources) {
+            long k = local_index[source];
+            while (poll_flag(flag_win, rank, arrived_index(k)) < timestep);
+          }
+          MPI_Win_sync(win);
+          break;
+        }
+
+        // Copy on-node inputs into their slots.
+        for (long point = std::max(first_point, offset); point <= std::min(last_point, offset + width - 1); ++point) {
+          long point_index = point - first_point;
+          auto &point_n_inputs = n_inputs[point_index];
+
+          point_n_inputs = 0;
+          for (auto interval : dependencies[dset][point_index]) {
+            for (long dep = interval.first; dep <= interval.second; ++dep) {
+              if (dep < last_offset || dep >= last_offset + last_width) {
+                continue;
+              }
+              if (first_point <= dep && dep <= last_point) {
+                memcpy(const_cast<char *>(input_ptr[parity][point_index][point_n_inputs]),
+                       outputs[dep - first_point].data(), output_bytes);
+              }
+              point_n_inputs++;
+            }
+          }
+        }
+
+        for (long point = std::max(first_point, offset); point <= std::min(last_point, offset + width - 1); ++point) {
+          long point_index = point - first_point;
+
+          auto &point_output = outputs[point_index];
+
+          char *scratch_ptr = scratch.acquire(0, graph.graph_index, timestep, point);
+          bound.execute_point(timestep, point,
+                              point_output.data(), point_output.size(),
+                              input_ptr[parity][point_index].data(), input_bytes[point_index].data(),
+                              n_inputs[point_index], scratch_ptr, scratch_bytes);
+          scratch.release(scratch_ptr);
+        }
+
+        if (sync == SYNC_PASSIVE) {
+          for (long k = 0; k < n_neighbors; ++k) {
+            set_flag(flag_win, neighbors[k], done_index(remote_index[k]), timestep);
+          }
+          MPI_Win_flush_all(flag_win);
+        }
+      }
+
+      if (sync == SYNC_PASSIVE) {
+        MPI_Win_unlock_all(flag_win);
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&flag_win);
+      }
+      MPI_Win_free(&win);
+
+      if (sync == SYNC_PSCW) {
+        for (auto &entry : plans) {
+          MPI_Group_free(&entry.second.source_group);
+          MPI_Group_free(&entry.second.dest_group);
+        }
+      }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    double stop_time = MPI_Wtime();
+    elapsed_time = stop_time - start_time;
+  }
+
+  if (rank == 0) {
+    app.report_timing(elapsed_time);
+  }
+
+  MPI_Group_free(&world_group);
+  MPI_Finalize();
+}
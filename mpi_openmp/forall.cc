@@ -13,14 +13,35 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <tuple>
+#include <omp.h>
 
 #include "core.h"
 
 #include "mpi.h"
 
+// Both sides of every rank pair post their messages in (to, from) order,
+// so MPI's non-overtaking rule matches them and the tag does not need to
+// encode any points. Same scheme as mpi/nonblock.cc.
+static const int MESSAGE_TAG = 0;
+
+struct Message {
+  int rank; // peer
+  long to;
+  long from;
+  long slot; // input index of the receiving point
+
+  bool operator<(const Message &other) const
+  {
+    return std::tie(rank, to, from) < std::tie(other.rank, other.to, other.from);
+  }
+};
+
 int main(int argc, char *argv[])
 {
   MPI_Init(&argc, &argv);
@@ -31,22 +52,10 @@ int main(int argc, char *argv[])
   App app(argc, argv);
   if (rank == 0) app.display();
 
-  std::vector<std::vector<char> > scratch;
-  for (auto graph : app.graphs) {
-    long first_point = rank * graph.max_width / n_ranks;
-    long last_point = (rank + 1) * graph.max_width / n_ranks - 1;
-    long n_points = last_point - first_point + 1;
-
-    size_t scratch_bytes = graph.scratch_bytes_per_task;
-    scratch.emplace_back(scratch_bytes * n_points);
-
-    char *scratch_ptr = scratch.back().data();
-
-    #pragma omp parallel for schedule(runtime)
-    for (long point = first_point; point <= last_point; ++point) {
-      long point_index = point - first_point;
-      TaskGraph::prepare_scratch(scratch_ptr + scratch_bytes * point_index, scratch_bytes);
-    }
+  ScratchManager scratch(app, omp_get_max_threads(), SCRATCH_PER_POINT, rank, n_ranks);
+  #pragma omp parallel
+  {
+    scratch.prepare_worker(omp_get_thread_num());
   }
 
   double elapsed_time = 0.0;
@@ -63,21 +72,12 @@ int main(int argc, char *argv[])
       long n_points = last_point - first_point + 1;
 
       size_t scratch_bytes = graph.scratch_bytes_per_task;
-      char *scratch_ptr = scratch[graph.graph_index].data();
-
-      std::vector<int> rank_by_point(graph.max_width);
-      std::vector<int> tag_bits_by_point(graph.max_width);
-      for (int r = 0; r < n_ranks; ++r) {
-        long r_first_point = r * graph.max_width / n_ranks;
-        long r_last_point = (r + 1) * graph.max_width / n_ranks - 1;
-        for (long p = r_first_point; p <= r_last_point; ++p) {
-          rank_by_point[p] = r;
-          tag_bits_by_point[p] = p - r_first_point;
-          // Has to fit in 7 bits because MPI only guarrantees that
-          // tags can use 15 bits.
-          assert((tag_bits_by_point[p] & ~0x7F) == 0);
-        }
-      }
+      BoundTaskGraph bound = graph.bind();
+
+      // Inverse of the block distribution above.
+      auto owner = [&](long point) {
+        return (int)(((point + 1) * n_ranks - 1) / graph.max_width);
+      };
 
       long max_deps = 0;
       for (long dset = 0; dset < graph.max_dependence_sets(); ++dset) {
@@ -132,6 +132,11 @@ int main(int argc, char *argv[])
         }
       }
 
+      // Messages of the last pattern seen, in posting order. Rebuilt
+      // only when the dependence set, offset or width change.
+      std::array<long, 5> plan_key = {{-1, -1, -1, -1, -1}};
+      std::vector<Message> recvs, sends;
+
       for (long timestep = 0; timestep < graph.timesteps; ++timestep) {
         long offset = graph.offset_at_timestep(timestep);
         long width = graph.width_at_timestep(timestep);
@@ -143,14 +148,19 @@ int main(int argc, char *argv[])
         auto &deps = dependencies[dset];
         auto &rev_deps = reverse_dependencies[dset];
 
-        requests.clear();
+        std::array<long, 5> key = {{dset, offset, width, last_offset, last_width}};
+        bool create = key != plan_key;
+        if (create) {
+          plan_key = key;
+          recvs.clear();
+          sends.clear();
+        }
 
         for (long point = first_point; point <= last_point; ++point) {
           long point_index = point - first_point;
 
           auto &point_inputs = inputs[point_index];
           auto &point_n_inputs = n_inputs[point_index];
-          auto &point_output = outputs[point_index];
 
           auto &point_deps = deps[point_index];
           auto &point_rev_deps = rev_deps[point_index];
@@ -168,15 +178,8 @@ int main(int argc, char *argv[])
                 if (first_point <= dep && dep <= last_point) {
                   auto &output = outputs[dep - first_point];
                   point_inputs[point_n_inputs].assign(output.begin(), output.end());
-                } else {
-                  int from = tag_bits_by_point[dep];
-                  int to = tag_bits_by_point[point];
-                  int tag = (from << 8) | to;
-                  MPI_Request req;
-                  MPI_Irecv(point_inputs[point_n_inputs].data(),
-                            point_inputs[point_n_inputs].size(), MPI_BYTE,
-                            rank_by_point[dep], tag, MPI_COMM_WORLD, &req);
-                  requests.push_back(req);
+                } else if (create) {
+                  recvs.push_back(Message{owner(dep), point, dep, point_n_inputs});
                 }
                 point_n_inputs++;
               }
@@ -184,25 +187,38 @@ int main(int argc, char *argv[])
           }
 
           /* Send */
-          if (point >= last_offset && point < last_offset + last_width) {
+          if (create && point >= last_offset && point < last_offset + last_width) {
             for (auto interval : point_rev_deps) {
               for (long dep = interval.first; dep <= interval.second; dep++) {
                 if (dep < offset || dep >= offset + width || (first_point <= dep && dep <= last_point)) {
                   continue;
                 }
 
-                int from = tag_bits_by_point[point];
-                int to = tag_bits_by_point[dep];
-                int tag = (from << 8) | to;
-                MPI_Request req;
-                MPI_Isend(point_output.data(), point_output.size(), MPI_BYTE,
-                          rank_by_point[dep], tag, MPI_COMM_WORLD, &req);
-                requests.push_back(req);
+                sends.push_back(Message{owner(dep), dep, point, 0});
               }
             }
           }
         }
 
+        if (create) {
+          std::sort(recvs.begin(), recvs.end());
+          std::sort(sends.begin(), sends.end());
+        }
+
+        requests.clear();
+        for (auto &m : recvs) {
+          auto &input = inputs[m.to - first_point][m.slot];
+          MPI_Request req;
+          MPI_Irecv(input.data(), input.size(), MPI_BYTE,
+                    m.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+          requests.push_back(req);
+        }
+        for (auto &m : sends) {
+          MPI_Request req;
+          MPI_Isend(outputs[m.from - first_point].data(), graph.output_bytes_at_point(timestep-1, m.from), MPI_BYTE,
+                    m.rank, MESSAGE_TAG, MPI_COMM_WORLD, &req);
+          requests.push_back(req);
+        }
         MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
 
         #pragma omp parallel for schedule(runtime)
@@ -214,10 +230,12 @@ int main(int argc, char *argv[])
           auto &point_n_inputs = n_inputs[point_index];
           auto &point_output = outputs[point_index];
 
-          graph.execute_point(timestep, point,
+          char *scratch_ptr = scratch.acquire(omp_get_thread_num(), graph.graph_index, timestep, point);
+          bound.execute_point(timestep, point,
                               point_output.data(), point_output.size(),
                               point_input_ptr.data(), point_input_bytes.data(), point_n_inputs,
-                              scratch_ptr + scratch_bytes * point_index, scratch_bytes);
+                              scratch_ptr, scratch_bytes);
+          scratch.release(scratch_ptr);
         }
       }
     }
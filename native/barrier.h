@@ -0,0 +1,125 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NATIVE_BARRIER_H
+#define NATIVE_BARRIER_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Busy-wait step. Falls back to yielding after a while so that an
+// oversubscribed machine still makes progress.
+inline void spin_pause(long &spins)
+{
+  if (++spins < 4096) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  } else {
+    std::this_thread::yield();
+  }
+}
+
+// An epoch counter on a cache line of its own.
+struct SpinFlag {
+  std::atomic<long> value;
+  char pad[64 - sizeof(std::atomic<long>)];
+
+  SpinFlag() : value(0) {}
+  SpinFlag(const SpinFlag &other) : value(other.value.load()) {}
+
+  void wait_until(long target) const
+  {
+    long spins = 0;
+    while (value.load(std::memory_order_acquire) < target) {
+      spin_pause(spins);
+    }
+  }
+};
+
+// Centralized sense-reversing barrier: one shared counter, and a shared
+// sense flag that the last arrival flips.
+class SenseBarrier {
+public:
+  explicit SenseBarrier(int workers)
+    : workers(workers), count(workers), sense(0), local_sense(workers)
+  {
+  }
+
+  void wait(int worker)
+  {
+    long local = 1 - local_sense[worker].value.load(std::memory_order_relaxed);
+    local_sense[worker].value.store(local, std::memory_order_relaxed);
+    if (count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      count.store(workers, std::memory_order_relaxed);
+      sense.store(local, std::memory_order_release);
+    } else {
+      long spins = 0;
+      while (sense.load(std::memory_order_acquire) != local) {
+        spin_pause(spins);
+      }
+    }
+  }
+
+private:
+  const int workers;
+  std::atomic<int> count;
+  char pad0[64 - sizeof(std::atomic<int>)];
+  std::atomic<long> sense;
+  char pad1[64 - sizeof(std::atomic<long>)];
+  std::vector<SpinFlag> local_sense; // owner only
+};
+
+// Static combining tree: each worker waits for its children to arrive,
+// reports to its parent, and then waits to be released by it. Every
+// flag has a single writer, so no worker spins on a contended line.
+class TreeBarrier {
+public:
+  static const int RADIX = 4;
+
+  explicit TreeBarrier(int workers)
+    : workers(workers), arrived(workers), released(workers), epoch(workers)
+  {
+  }
+
+  void wait(int worker)
+  {
+    long e = epoch[worker].value.load(std::memory_order_relaxed) + 1;
+    epoch[worker].value.store(e, std::memory_order_relaxed);
+
+    int first_child = worker * RADIX + 1;
+    int last_child = std::min(first_child + RADIX, workers);
+    for (int child = first_child; child < last_child; child++) {
+      arrived[child].wait_until(e);
+    }
+    if (worker > 0) {
+      arrived[worker].value.store(e, std::memory_order_release);
+      released[worker].wait_until(e);
+    }
+    for (int child = first_child; child < last_child; child++) {
+      released[child].value.store(e, std::memory_order_release);
+    }
+  }
+
+private:
+  const int workers;
+  std::vector<SpinFlag> arrived;
+  std::vector<SpinFlag> released;
+  std::vector<SpinFlag> epoch; // owner only
+};
+
+#endif
@@ -0,0 +1,492 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Dataflow executor where every task is a C++20 coroutine. A task
+// co_awaits the completion event of each input (and of each reader of
+// the ring slot it overwrites), runs, signals its own event, and spawns
+// the next task of its point. Suspended coroutines are resumed on the
+// work-stealing pool of main.cc. Requires -std=c++20.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+#include "deque.h"
+#include "timer.h"
+
+// Recycles coroutine frames through a per-thread free list. Frames of
+// one coroutine type all have the same size, so a single size class is
+// enough; other sizes go straight to malloc.
+class FrameAllocator {
+public:
+  static void *allocate(size_t bytes)
+  {
+    FreeList &list = cache;
+    if (enabled && list.head != NULL && list.bytes == bytes) {
+      Block *block = list.head;
+      list.head = block->next;
+      list.count--;
+      return block;
+    }
+    void *ptr = malloc(std::max(bytes, sizeof(Block)));
+    assert(ptr);
+    return ptr;
+  }
+
+  static void deallocate(void *ptr, size_t bytes)
+  {
+    FreeList &list = cache;
+    if (list.bytes == 0) {
+      list.bytes = bytes;
+    }
+    // Frames are often freed by a different worker than the one that
+    // allocated them, so cap what a single thread can hoard.
+    if (enabled && list.bytes == bytes && list.count < MAX_CACHED) {
+      Block *block = (Block *)ptr;
+      block->next = list.head;
+      list.head = block;
+      list.count++;
+      return;
+    }
+    free(ptr);
+  }
+
+  static bool enabled;
+
+private:
+  static const long MAX_CACHED = 4096;
+
+  struct Block {
+    Block *next;
+  };
+
+  struct FreeList {
+    Block *head;
+    size_t bytes;
+    long count;
+
+    ~FreeList()
+    {
+      while (head) {
+        Block *next = head->next;
+        free(head);
+        head = next;
+      }
+    }
+  };
+
+  static thread_local FreeList cache;
+};
+
+bool FrameAllocator::enabled = true;
+thread_local FrameAllocator::FreeList FrameAllocator::cache = {NULL, 0, 0};
+
+struct CoroutineApp;
+
+// Fire-and-forget coroutine. It starts suspended so that spawn() can
+// hand it to the scheduler, and its frame is freed when it returns.
+struct Task {
+  struct promise_type {
+    Task get_return_object()
+    {
+      return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { abort(); }
+
+    static void *operator new(size_t bytes) { return FrameAllocator::allocate(bytes); }
+    static void operator delete(void *ptr, size_t bytes) { FrameAllocator::deallocate(ptr, bytes); }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+// Set-once event. Waiters form an intrusive list in the state word until
+// the event is set; set() moves them to the scheduler.
+class Event {
+public:
+  Event() : state(NULL) {}
+
+  struct Awaiter {
+    Event &event;
+    std::coroutine_handle<> handle;
+    Awaiter *next;
+
+    bool await_ready() const noexcept { return event.is_set(); }
+    bool await_suspend(std::coroutine_handle<> h) noexcept
+    {
+      handle = h;
+      void *old = event.state.load(std::memory_order_acquire);
+      do {
+        if (old == &event) return false; // set in the meantime
+        next = (Awaiter *)old;
+      } while (!event.state.compare_exchange_weak(old, this, std::memory_order_release,
+                                                  std::memory_order_acquire));
+      return true;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  Awaiter operator co_await() noexcept { return Awaiter{*this, NULL, NULL}; }
+
+  bool is_set() const { return state.load(std::memory_order_acquire) == this; }
+
+  // Returns the list of coroutines that were waiting.
+  Awaiter *set()
+  {
+    return (Awaiter *)state.exchange(this, std::memory_order_acq_rel);
+  }
+
+private:
+  // NULL: not set, no waiters. this: set. Otherwise: list of waiters.
+  std::atomic<void *> state;
+};
+
+struct GraphState {
+  long base; // id of (0, 0)
+  long fields;
+  size_t tile_bytes;
+  char *slab; // column-major, like openmp/main.cc
+  Event *events; // timesteps x max_width
+
+  char *tile(long t, long p) const
+  {
+    return slab + ((size_t)p * fields + t % fields) * tile_bytes;
+  }
+  Event &event(long t, long p, long max_width) const
+  {
+    return events[t * max_width + p];
+  }
+};
+
+static thread_local int current_worker = -1;
+
+struct CoroutineApp : public App {
+  CoroutineApp(int argc, char **argv);
+  ~CoroutineApp();
+  void execute_main_loop();
+private:
+  Task run_task(long graph_index, long t, long p);
+  void spawn(long graph_index, long t, long p);
+  void schedule(std::coroutine_handle<> handle);
+  void execute_point(long graph_index, long t, long p);
+  void prepare_worker(int worker);
+  void worker_loop(int worker);
+  void worker_thread(int worker);
+  long next_timestep(const TaskGraph &g, long t, long p) const;
+  bool valid(const TaskGraph &g, long t, long p) const
+  {
+    return t >= 0 && t < g.timesteps &&
+           p >= g.offset_at_timestep(t) &&
+           p < g.offset_at_timestep(t) + g.width_at_timestep(t);
+  }
+private:
+  int nb_workers;
+  std::vector<GraphState> states;
+  std::vector<BoundTaskGraph> bound_graphs;
+  std::vector<WorkDeque<void *> *> deques;
+  ScratchManager *scratch;
+  std::atomic<long> remaining;
+  std::atomic<int> ready_workers;
+  std::atomic<bool> started;
+};
+
+CoroutineApp::CoroutineApp(int argc, char **argv)
+  : App(argc, argv)
+  , remaining(0)
+  , ready_workers(0)
+  , started(false)
+{
+  nb_workers = 1;
+
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-worker")) {
+      nb_workers = atol(argv[++k]);
+      if (nb_workers <= 0) {
+        fprintf(stderr, "error: Invalid flag \"-worker %d\" must be > 0\n", nb_workers);
+        abort();
+      }
+    }
+    if (!strcmp(argv[k], "-frame-alloc")) {
+      const char *name = argv[++k];
+      if (!strcmp(name, "pool")) {
+        FrameAllocator::enabled = true;
+      } else if (!strcmp(name, "malloc")) {
+        FrameAllocator::enabled = false;
+      } else {
+        fprintf(stderr, "error: Invalid flag \"-frame-alloc %s\" must be pool or malloc\n", name);
+        abort();
+      }
+    }
+  }
+
+  long base = 0;
+  long total_tasks = 0;
+  for (unsigned i = 0; i < graphs.size(); i++) {
+    const TaskGraph &g = graphs[i];
+    bound_graphs.push_back(g.bind());
+
+    GraphState s;
+    s.base = base;
+    // A single field would make a task's inputs and output alias.
+    s.fields = std::max((long)g.nb_fields, std::min(g.timesteps, 2L));
+    s.tile_bytes = (g.output_bytes_per_task + TASK_BENCH_CACHE_LINE - 1) / TASK_BENCH_CACHE_LINE * TASK_BENCH_CACHE_LINE;
+    s.slab = (char *)task_bench_alloc(s.tile_bytes * s.fields * g.max_width, alloc_policy);
+    s.events = new Event[g.timesteps * g.max_width];
+    states.push_back(s);
+
+    base += g.timesteps * g.max_width;
+    for (long t = 0; t < g.timesteps; t++) {
+      total_tasks += g.width_at_timestep(t);
+    }
+  }
+  remaining = total_tasks;
+
+  for (int w = 0; w < nb_workers; w++) {
+    deques.push_back(new WorkDeque<void *>());
+  }
+  scratch = new ScratchManager(*this, nb_workers, SCRATCH_PER_WORKER);
+}
+
+CoroutineApp::~CoroutineApp()
+{
+  for (auto &s : states) {
+    task_bench_free(s.slab);
+    delete [] s.events;
+  }
+  for (auto d : deques) {
+    delete d;
+  }
+  delete scratch;
+}
+
+long CoroutineApp::next_timestep(const TaskGraph &g, long t, long p) const
+{
+  for (t++; t < g.timesteps; t++) {
+    if (valid(g, t, p)) return t;
+  }
+  return -1;
+}
+
+inline void CoroutineApp::schedule(std::coroutine_handle<> handle)
+{
+  assert(current_worker >= 0);
+  deques[current_worker]->push(handle.address());
+}
+
+void CoroutineApp::spawn(long graph_index, long t, long p)
+{
+  schedule(run_task(graph_index, t, p).handle);
+}
+
+Task CoroutineApp::run_task(long graph_index, long t, long p)
+{
+  const TaskGraph &g = graphs[graph_index];
+  const GraphState &s = states[graph_index];
+
+  // Inputs from timestep t-1. The previous writer of the slot already
+  // finished: it is what spawned this task.
+  if (t > 0) {
+    long offset = g.offset_at_timestep(t-1);
+    long width = g.width_at_timestep(t-1);
+    for (auto &dep : g.dependencies(g.dependence_set_at_timestep(t), p)) {
+      long first = std::max(dep.first, offset);
+      long last = std::min(dep.second, offset + width - 1);
+      for (long q = first; q <= last; q++) {
+        co_await s.event(t-1, q, g.max_width);
+      }
+    }
+  }
+
+  // Readers of the value this task overwrites.
+  long prev = t - s.fields;
+  if (valid(g, prev, p)) {
+    long reader_t = prev + 1;
+    long offset = g.offset_at_timestep(reader_t);
+    long width = g.width_at_timestep(reader_t);
+    for (auto &rdep : g.reverse_dependencies(g.dependence_set_at_timestep(reader_t), p)) {
+      long first = std::max(rdep.first, offset);
+      long last = std::min(rdep.second, offset + width - 1);
+      for (long q = first; q <= last; q++) {
+        co_await s.event(reader_t, q, g.max_width);
+      }
+    }
+  }
+
+  execute_point(graph_index, t, p);
+
+  for (Event::Awaiter *waiter = s.event(t, p, g.max_width).set(); waiter != NULL; ) {
+    Event::Awaiter *next = waiter->next; // waiter lives in a frame that may resume
+    schedule(waiter->handle);
+    waiter = next;
+  }
+
+  long next_t = next_timestep(g, t, p);
+  if (next_t >= 0) {
+    spawn(graph_index, next_t, p);
+  }
+
+  remaining.fetch_sub(1, std::memory_order_release);
+}
+
+void CoroutineApp::execute_point(long graph_index, long t, long p)
+{
+  const TaskGraph &g = graphs[graph_index];
+  const GraphState &s = states[graph_index];
+
+  const char **input_ptrs = NULL;
+  size_t *input_bytes = NULL;
+  size_t n_inputs = 0;
+  if (t > 0) {
+    long dset = g.dependence_set_at_timestep(t);
+    size_t max_deps = g.num_dependencies(dset, p);
+    std::pair<long, long> *deps = (std::pair<long, long> *)alloca(sizeof(std::pair<long, long>) * max_deps);
+    size_t num_deps = g.dependencies(dset, p, deps);
+
+    size_t max_inputs = 0;
+    for (size_t span = 0; span < num_deps; span++) {
+      max_inputs += deps[span].second - deps[span].first + 1;
+    }
+    input_ptrs = (const char **)alloca(sizeof(const char *) * max_inputs);
+    input_bytes = (size_t *)alloca(sizeof(size_t) * max_inputs);
+
+    long last_offset = g.offset_at_timestep(t-1);
+    long last_width = g.width_at_timestep(t-1);
+    for (size_t span = 0; span < num_deps; span++) {
+      for (long i = deps[span].first; i <= deps[span].second; i++) {
+        if (i >= last_offset && i < last_offset + last_width) {
+          input_ptrs[n_inputs] = s.tile(t-1, i);
+          input_bytes[n_inputs] = g.output_bytes_per_task;
+          n_inputs++;
+        }
+      }
+    }
+  }
+
+  char *scratch_ptr = scratch->acquire(current_worker, graph_index, t, p);
+  bound_graphs[graph_index].execute_point(t, p, s.tile(t, p), g.output_bytes_per_task,
+                                          input_ptrs, input_bytes, n_inputs,
+                                          scratch_ptr, g.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
+}
+
+void CoroutineApp::prepare_worker(int worker)
+{
+  current_worker = worker;
+
+  // Columns are first-touched by a static partition, as in openmp/main.cc.
+  if (alloc_policy.placement == ALLOC_DEFAULT || alloc_policy.placement == ALLOC_FIRST_TOUCH) {
+    for (unsigned i = 0; i < graphs.size(); i++) {
+      long width = graphs[i].max_width;
+      size_t column_bytes = states[i].tile_bytes * states[i].fields;
+      for (long p = worker * width / nb_workers; p < (worker + 1) * width / nb_workers; p++) {
+        task_bench_first_touch(states[i].slab + p * column_bytes, column_bytes);
+      }
+    }
+  }
+  scratch->prepare_worker(worker);
+}
+
+void CoroutineApp::worker_thread(int worker)
+{
+  prepare_worker(worker);
+  ready_workers.fetch_add(1);
+  while (!started.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  worker_loop(worker);
+}
+
+void CoroutineApp::worker_loop(int worker)
+{
+  WorkDeque<void *> &deque = *deques[worker];
+
+  // Each point's first task; the rest are spawned by their predecessor.
+  for (unsigned i = 0; i < graphs.size(); i++) {
+    const TaskGraph &g = graphs[i];
+    for (long p = worker; p < g.max_width; p += nb_workers) {
+      long t = next_timestep(g, -1, p);
+      if (t >= 0) {
+        spawn(i, t, p);
+      }
+    }
+  }
+
+  std::minstd_rand rng(worker + 1);
+  void *task;
+  while (remaining.load(std::memory_order_acquire) > 0) {
+    if (deque.pop(task)) {
+      std::coroutine_handle<>::from_address(task).resume();
+      continue;
+    }
+    bool stolen = false;
+    for (int attempt = 0; attempt < nb_workers && !stolen; attempt++) {
+      int victim = rng() % nb_workers;
+      if (victim != worker && deques[victim]->steal(task)) {
+        stolen = true;
+      }
+    }
+    if (stolen) {
+      std::coroutine_handle<>::from_address(task).resume();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void CoroutineApp::execute_main_loop()
+{
+  display();
+
+  std::vector<std::thread> threads;
+  for (int w = 1; w < nb_workers; w++) {
+    threads.emplace_back(&CoroutineApp::worker_thread, this, w);
+  }
+  // Worker 0 is this thread.
+  prepare_worker(0);
+  while (ready_workers.load() < nb_workers - 1) {
+    std::this_thread::yield();
+  }
+
+  Timer::time_start();
+  started.store(true, std::memory_order_release);
+  worker_loop(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double elapsed = Timer::time_end();
+
+  report_timing(elapsed);
+  scratch->report_locality(elapsed);
+}
+
+int main(int argc, char **argv)
+{
+  CoroutineApp app(argc, argv);
+  app.execute_main_loop();
+
+  return 0;
+}
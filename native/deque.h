@@ -0,0 +1,139 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NATIVE_DEQUE_H
+#define NATIVE_DEQUE_H
+
+#include <atomic>
+#include <vector>
+
+// Chase-Lev work-stealing deque, following the C11 formulation of Le,
+// Pop, Cohen and Zappa Nardelli (PPoPP'13). The owner pushes and pops
+// at the bottom; thieves steal from the top. Arrays that are outgrown
+// are kept until the deque is destroyed, since a thief may still be
+// reading from them.
+template <typename T>
+class WorkDeque {
+public:
+  explicit WorkDeque(long log_capacity = 10)
+    : top(0), bottom(0), array(new Array(log_capacity))
+  {
+  }
+
+  ~WorkDeque()
+  {
+    delete array.load(std::memory_order_relaxed);
+    for (Array *a : retired) {
+      delete a;
+    }
+  }
+
+  WorkDeque(const WorkDeque &) = delete;
+  WorkDeque &operator=(const WorkDeque &) = delete;
+
+  // Owner only.
+  void push(T value)
+  {
+    long b = bottom.load(std::memory_order_relaxed);
+    long t = top.load(std::memory_order_acquire);
+    Array *a = array.load(std::memory_order_relaxed);
+    if (b - t > a->mask) {
+      a = grow(a, t, b);
+    }
+    a->put(b, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // Owner only. Returns false if the deque is empty.
+  bool pop(T &value)
+  {
+    long b = bottom.load(std::memory_order_relaxed) - 1;
+    Array *a = array.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    value = a->get(b);
+    if (t == b) {
+      // Last element: race against thieves for it.
+      bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed);
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  // Any thread. Returns false if the deque is empty or the steal lost a race.
+  bool steal(T &value)
+  {
+    long t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long b = bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+      return false;
+    }
+
+    Array *a = array.load(std::memory_order_consume);
+    value = a->get(t);
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed);
+  }
+
+private:
+  struct Array {
+    explicit Array(long log_capacity)
+      : mask((1L << log_capacity) - 1), log_capacity(log_capacity),
+        data(new std::atomic<T>[1L << log_capacity])
+    {
+    }
+    ~Array() { delete [] data; }
+
+    T get(long i) const { return data[i & mask].load(std::memory_order_relaxed); }
+    void put(long i, T value) { data[i & mask].store(value, std::memory_order_relaxed); }
+
+    const long mask;
+    const long log_capacity;
+    std::atomic<T> *data;
+  };
+
+  Array *grow(Array *a, long t, long b)
+  {
+    Array *bigger = new Array(a->log_capacity + 1);
+    for (long i = t; i < b; i++) {
+      bigger->put(i, a->get(i));
+    }
+    retired.push_back(a);
+    array.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  // top and bottom are written by different threads; keep them on
+  // separate cache lines.
+  std::atomic<long> top;
+  char pad0[64 - sizeof(std::atomic<long>)];
+  std::atomic<long> bottom;
+  char pad1[64 - sizeof(std::atomic<long>)];
+  std::atomic<Array *> array;
+  std::vector<Array *> retired; // owner only
+};
+
+#endif
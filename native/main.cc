@@ -0,0 +1,402 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Minimal-overhead reference executor: no runtime system, just per-worker
+// Chase-Lev deques and an atomic in-degree counter per (timestep, point).
+// A finished task decrements its successors and pushes those that become
+// ready onto its own deque; idle workers steal. Outputs use the same
+// nb_fields ring as the other shared-memory backends, so besides the true
+// dependencies a task also waits for the previous writer of its slot and
+// for every reader of the value it overwrites. Under SCRATCH_PER_POINT the
+// tasks of a point share one scratch block, so they are also chained in
+// timestep order.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+#include "deque.h"
+#include "timer.h"
+
+struct GraphState {
+  long base; // id of (0, 0)
+  long fields;
+  size_t tile_bytes;
+  char *slab; // column-major, like openmp/main.cc
+  std::atomic<int> *counters; // timesteps x max_width
+
+  char *tile(long t, long p) const
+  {
+    return slab + ((size_t)p * fields + t % fields) * tile_bytes;
+  }
+};
+
+struct NativeApp : public App {
+  NativeApp(int argc, char **argv);
+  ~NativeApp();
+  void execute_main_loop();
+private:
+  void prepare_worker(int worker);
+  void worker_loop(int worker);
+  void worker_thread(int worker);
+  void execute_task(int worker, long id);
+  void release(WorkDeque<long> &deque, long graph_index, long t, long p);
+  long initial_count(long graph_index, long t, long p) const;
+  bool valid(const TaskGraph &g, long t, long p) const
+  {
+    return t >= 0 && t < g.timesteps &&
+           p >= g.offset_at_timestep(t) &&
+           p < g.offset_at_timestep(t) + g.width_at_timestep(t);
+  }
+  // Previous and next timesteps in which p runs, or -1.
+  long point_pred(const TaskGraph &g, long t, long p) const
+  {
+    for (long u = t - 1; u >= 0; u--) {
+      if (valid(g, u, p)) return u;
+    }
+    return -1;
+  }
+  long point_succ(const TaskGraph &g, long t, long p) const
+  {
+    for (long u = t + 1; u < g.timesteps; u++) {
+      if (valid(g, u, p)) return u;
+    }
+    return -1;
+  }
+private:
+  int nb_workers;
+  std::vector<GraphState> states;
+  std::vector<BoundTaskGraph> bound_graphs;
+  std::vector<WorkDeque<long> *> deques;
+  ScratchManager *scratch;
+  bool point_order; // chain the tasks of each point
+  std::vector<long> roots;
+  std::atomic<long> remaining;
+  std::atomic<int> ready_workers;
+  std::atomic<bool> started;
+};
+
+NativeApp::NativeApp(int argc, char **argv)
+  : App(argc, argv)
+  , remaining(0)
+  , ready_workers(0)
+  , started(false)
+{
+  nb_workers = 1;
+
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-worker")) {
+      nb_workers = atol(argv[++k]);
+      if (nb_workers <= 0) {
+        fprintf(stderr, "error: Invalid flag \"-worker %d\" must be > 0\n", nb_workers);
+        abort();
+      }
+    }
+  }
+
+  long base = 0;
+  long total_tasks = 0;
+  for (unsigned i = 0; i < graphs.size(); i++) {
+    const TaskGraph &g = graphs[i];
+    bound_graphs.push_back(g.bind());
+
+    GraphState s;
+    s.base = base;
+    // A single field would make a task's inputs and output alias.
+    s.fields = std::max((long)g.nb_fields, std::min(g.timesteps, 2L));
+    s.tile_bytes = (g.output_bytes_per_task + TASK_BENCH_CACHE_LINE - 1) / TASK_BENCH_CACHE_LINE * TASK_BENCH_CACHE_LINE;
+    s.slab = (char *)task_bench_alloc(s.tile_bytes * s.fields * g.max_width, alloc_policy);
+    s.counters = new std::atomic<int>[g.timesteps * g.max_width];
+    states.push_back(s);
+
+    base += g.timesteps * g.max_width;
+    for (long t = 0; t < g.timesteps; t++) {
+      total_tasks += g.width_at_timestep(t);
+    }
+  }
+  remaining = total_tasks;
+
+  scratch = new ScratchManager(*this, nb_workers, SCRATCH_PER_WORKER);
+  point_order = scratch->policy() == SCRATCH_PER_POINT;
+
+  // Counters are set up front so that the timed region only decrements.
+  for (unsigned i = 0; i < graphs.size(); i++) {
+    const TaskGraph &g = graphs[i];
+    for (long t = 0; t < g.timesteps; t++) {
+      long offset = g.offset_at_timestep(t);
+      long width = g.width_at_timestep(t);
+      for (long p = offset; p < offset + width; p++) {
+        long count = initial_count(i, t, p);
+        states[i].counters[t * g.max_width + p] = count;
+        if (count == 0) {
+          roots.push_back(states[i].base + t * g.max_width + p);
+        }
+      }
+    }
+  }
+
+  for (int w = 0; w < nb_workers; w++) {
+    deques.push_back(new WorkDeque<long>());
+  }
+}
+
+NativeApp::~NativeApp()
+{
+  for (auto &s : states) {
+    task_bench_free(s.slab);
+    delete [] s.counters;
+  }
+  for (auto d : deques) {
+    delete d;
+  }
+  delete scratch;
+}
+
+long NativeApp::initial_count(long graph_index, long t, long p) const
+{
+  const TaskGraph &g = graphs[graph_index];
+  long fields = states[graph_index].fields;
+  long count = 0;
+
+  // True dependencies on timestep t-1.
+  if (t > 0) {
+    long last_offset = g.offset_at_timestep(t-1);
+    long last_width = g.width_at_timestep(t-1);
+    for (auto &dep : g.dependencies(g.dependence_set_at_timestep(t), p)) {
+      long first = std::max(dep.first, last_offset);
+      long last = std::min(dep.second, last_offset + last_width - 1);
+      count += std::max(0L, last - first + 1);
+    }
+  }
+
+  // The slot is reused from timestep t-fields: wait for its writer and
+  // for every task of timestep t-fields+1 that reads it.
+  long prev = t - fields;
+  if (valid(g, prev, p)) {
+    count++;
+    long reader_t = prev + 1;
+    long offset = g.offset_at_timestep(reader_t);
+    long width = g.width_at_timestep(reader_t);
+    for (auto &rdep : g.reverse_dependencies(g.dependence_set_at_timestep(reader_t), p)) {
+      long first = std::max(rdep.first, offset);
+      long last = std::min(rdep.second, offset + width - 1);
+      count += std::max(0L, last - first + 1);
+    }
+  }
+
+  if (point_order && point_pred(g, t, p) >= 0) {
+    count++;
+  }
+  return count;
+}
+
+inline void NativeApp::release(WorkDeque<long> &deque, long graph_index, long t, long p)
+{
+  const TaskGraph &g = graphs[graph_index];
+  GraphState &s = states[graph_index];
+  long index = t * g.max_width + p;
+  if (s.counters[index].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    deque.push(s.base + index);
+  }
+}
+
+void NativeApp::execute_task(int worker, long id)
+{
+  long graph_index = graphs.size() - 1;
+  while (states[graph_index].base > id) {
+    graph_index--;
+  }
+  const TaskGraph &g = graphs[graph_index];
+  const GraphState &s = states[graph_index];
+  long t = (id - s.base) / g.max_width;
+  long p = (id - s.base) % g.max_width;
+  WorkDeque<long> &deque = *deques[worker];
+
+  const char **input_ptrs = NULL;
+  size_t *input_bytes = NULL;
+  size_t n_inputs = 0;
+  size_t num_deps = 0;
+  std::pair<long, long> *deps = NULL;
+  long last_offset = 0, last_width = 0;
+  if (t > 0) {
+    long dset = g.dependence_set_at_timestep(t);
+    deps = (std::pair<long, long> *)alloca(sizeof(std::pair<long, long>) * g.num_dependencies(dset, p));
+    num_deps = g.dependencies(dset, p, deps);
+
+    size_t max_inputs = 0;
+    for (size_t span = 0; span < num_deps; span++) {
+      max_inputs += deps[span].second - deps[span].first + 1;
+    }
+    input_ptrs = (const char **)alloca(sizeof(const char *) * max_inputs);
+    input_bytes = (size_t *)alloca(sizeof(size_t) * max_inputs);
+
+    last_offset = g.offset_at_timestep(t-1);
+    last_width = g.width_at_timestep(t-1);
+    for (size_t span = 0; span < num_deps; span++) {
+      for (long i = deps[span].first; i <= deps[span].second; i++) {
+        if (i >= last_offset && i < last_offset + last_width) {
+          input_ptrs[n_inputs] = s.tile(t-1, i);
+          input_bytes[n_inputs] = g.output_bytes_per_task;
+          n_inputs++;
+        }
+      }
+    }
+  }
+
+  char *scratch_ptr = scratch->acquire(worker, graph_index, t, p);
+  bound_graphs[graph_index].execute_point(t, p, s.tile(t, p), g.output_bytes_per_task,
+                                          input_ptrs, input_bytes, n_inputs,
+                                          scratch_ptr, g.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
+
+  // Consumers of this output.
+  if (t + 1 < g.timesteps) {
+    long offset = g.offset_at_timestep(t+1);
+    long width = g.width_at_timestep(t+1);
+    long dset = g.dependence_set_at_timestep(t+1);
+    std::pair<long, long> *rdeps = (std::pair<long, long> *)alloca(sizeof(std::pair<long, long>) * g.num_reverse_dependencies(dset, p));
+    size_t num_rdeps = g.reverse_dependencies(dset, p, rdeps);
+    for (size_t span = 0; span < num_rdeps; span++) {
+      long first = std::max(rdeps[span].first, offset);
+      long last = std::min(rdeps[span].second, offset + width - 1);
+      for (long q = first; q <= last; q++) {
+        release(deque, graph_index, t+1, q);
+      }
+    }
+  }
+
+  // Next writer of this slot.
+  if (valid(g, t + s.fields, p)) {
+    release(deque, graph_index, t + s.fields, p);
+  }
+
+  // Next writers of the slots this task read.
+  for (size_t span = 0; span < num_deps; span++) {
+    long first = std::max(deps[span].first, last_offset);
+    long last = std::min(deps[span].second, last_offset + last_width - 1);
+    for (long q = first; q <= last; q++) {
+      if (valid(g, t - 1 + s.fields, q)) {
+        release(deque, graph_index, t - 1 + s.fields, q);
+      }
+    }
+  }
+
+  // Next task sharing this point's scratch block.
+  if (point_order) {
+    long next = point_succ(g, t, p);
+    if (next >= 0) {
+      release(deque, graph_index, next, p);
+    }
+  }
+
+  remaining.fetch_sub(1, std::memory_order_release);
+}
+
+void NativeApp::prepare_worker(int worker)
+{
+  // Columns are first-touched by a static partition, as in openmp/main.cc.
+  if (alloc_policy.placement == ALLOC_DEFAULT || alloc_policy.placement == ALLOC_FIRST_TOUCH) {
+    for (unsigned i = 0; i < graphs.size(); i++) {
+      long width = graphs[i].max_width;
+      size_t column_bytes = states[i].tile_bytes * states[i].fields;
+      for (long p = worker * width / nb_workers; p < (worker + 1) * width / nb_workers; p++) {
+        task_bench_first_touch(states[i].slab + p * column_bytes, column_bytes);
+      }
+    }
+  }
+  scratch->prepare_worker(worker);
+}
+
+void NativeApp::worker_thread(int worker)
+{
+  prepare_worker(worker);
+  ready_workers.fetch_add(1);
+  while (!started.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  worker_loop(worker);
+}
+
+void NativeApp::worker_loop(int worker)
+{
+  WorkDeque<long> &deque = *deques[worker];
+
+  for (size_t r = worker; r < roots.size(); r += nb_workers) {
+    deque.push(roots[r]);
+  }
+
+  std::minstd_rand rng(worker + 1);
+  long id;
+  while (remaining.load(std::memory_order_acquire) > 0) {
+    if (deque.pop(id)) {
+      execute_task(worker, id);
+      continue;
+    }
+    bool stolen = false;
+    for (int attempt = 0; attempt < nb_workers && !stolen; attempt++) {
+      int victim = rng() % nb_workers;
+      if (victim != worker && deques[victim]->steal(id)) {
+        stolen = true;
+      }
+    }
+    if (stolen) {
+      execute_task(worker, id);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void NativeApp::execute_main_loop()
+{
+  display();
+
+  std::vector<std::thread> threads;
+  for (int w = 1; w < nb_workers; w++) {
+    threads.emplace_back(&NativeApp::worker_thread, this, w);
+  }
+  // Worker 0 is this thread.
+  prepare_worker(0);
+  while (ready_workers.load() < nb_workers - 1) {
+    std::this_thread::yield();
+  }
+
+  Timer::time_start();
+  started.store(true, std::memory_order_release);
+  worker_loop(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double elapsed = Timer::time_end();
+
+  report_timing(elapsed);
+  scratch->report_locality(elapsed);
+}
+
+int main(int argc, char **argv)
+{
+  NativeApp app(argc, argv);
+  app.execute_main_loop();
+
+  return 0;
+}
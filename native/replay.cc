@@ -0,0 +1,494 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Capture and replay. Once offset and width stop changing, a graph
+// repeats every timestep_period() timesteps, so a window of a multiple
+// of that many timesteps is compiled once into a flat schedule
+// (successor lists, initial counters, roots per worker) and then
+// replayed window after window with nothing but a counter reset. Within
+// a window tasks run as in main.cc; windows are separated by a barrier,
+// which also covers every dependence that crosses a window boundary.
+// Timesteps before the graph reaches its steady shape, and a trailing
+// partial window, get schedules of their own that are used once.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "barrier.h"
+#include "core.h"
+#include "deque.h"
+#include "timer.h"
+
+// One captured window of timesteps. Task ids are dense indices into
+// the arrays below; timesteps are relative to the start of the window.
+struct Schedule {
+  long timesteps;
+  std::vector<long> task_t;
+  std::vector<long> task_p;
+  std::vector<int> initial; // in-degree within the window
+  std::vector<long> succ_begin; // CSR, size tasks + 1
+  std::vector<long> succ;
+  std::vector<std::vector<long> > roots; // per worker
+
+  long tasks() const { return task_t.size(); }
+};
+
+// A schedule instantiated at an absolute timestep.
+struct Window {
+  const Schedule *schedule;
+  long start;
+};
+
+struct GraphState {
+  long fields;
+  size_t tile_bytes;
+  char *slab; // column-major, like openmp/main.cc
+  std::vector<Schedule *> schedules;
+  std::vector<Window> windows;
+  std::atomic<int> *counters; // sized for the largest schedule
+
+  char *tile(long t, long p) const
+  {
+    return slab + ((size_t)p * fields + t % fields) * tile_bytes;
+  }
+};
+
+// Work for one launch: the next window of every graph that has one.
+struct Launch {
+  std::vector<long> graph_index;
+  std::vector<long> base; // first task id of each entry
+  long tasks;
+};
+
+struct ReplayApp : public App {
+  ReplayApp(int argc, char **argv);
+  ~ReplayApp();
+  void execute_main_loop();
+private:
+  Schedule *capture(long graph_index, long start, long timesteps) const;
+  void execute_task(int worker, const Launch &launch, long id);
+  void prepare_worker(int worker);
+  void worker_loop(int worker);
+  void worker_thread(int worker);
+  bool valid(const TaskGraph &g, long t, long p) const
+  {
+    return t >= 0 && t < g.timesteps &&
+           p >= g.offset_at_timestep(t) &&
+           p < g.offset_at_timestep(t) + g.width_at_timestep(t);
+  }
+private:
+  int nb_workers;
+  long window_steps;
+  std::vector<GraphState> states;
+  std::vector<BoundTaskGraph> bound_graphs;
+  std::vector<Launch> launches;
+  std::vector<WorkDeque<long> *> deques;
+  SenseBarrier *barrier;
+  ScratchManager *scratch;
+  bool point_order; // chain the tasks of each point (SCRATCH_PER_POINT)
+  std::atomic<long> remaining;
+  std::atomic<int> ready_workers;
+  std::atomic<bool> started;
+};
+
+ReplayApp::ReplayApp(int argc, char **argv)
+  : App(argc, argv)
+  , remaining(0)
+  , ready_workers(0)
+  , started(false)
+{
+  nb_workers = 1;
+  window_steps = 64;
+
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-worker")) {
+      nb_workers = atol(argv[++k]);
+      if (nb_workers <= 0) {
+        fprintf(stderr, "error: Invalid flag \"-worker %d\" must be > 0\n", nb_workers);
+        abort();
+      }
+    }
+    if (!strcmp(argv[k], "-window")) {
+      window_steps = atol(argv[++k]);
+      if (window_steps <= 0) {
+        fprintf(stderr, "error: Invalid flag \"-window %ld\" must be > 0\n", window_steps);
+        abort();
+      }
+    }
+  }
+
+  // Needed by capture().
+  scratch = new ScratchManager(*this, nb_workers, SCRATCH_PER_WORKER);
+  point_order = scratch->policy() == SCRATCH_PER_POINT;
+
+  for (unsigned i = 0; i < graphs.size(); i++) {
+    const TaskGraph &g = graphs[i];
+    bound_graphs.push_back(g.bind());
+
+    states.push_back(GraphState());
+    GraphState &s = states.back();
+    // A single field would make a task's inputs and output alias.
+    s.fields = std::max((long)g.nb_fields, std::min(g.timesteps, 2L));
+    s.tile_bytes = (g.output_bytes_per_task + TASK_BENCH_CACHE_LINE - 1) / TASK_BENCH_CACHE_LINE * TASK_BENCH_CACHE_LINE;
+    s.slab = (char *)task_bench_alloc(s.tile_bytes * s.fields * g.max_width, alloc_policy);
+
+    // First timestep from which every timestep spans the full width.
+    // Timestep 0 reads nothing, so it never matches the later ones.
+    long steady = g.timesteps;
+    while (steady > 1 && g.offset_at_timestep(steady-1) == 0 &&
+           g.width_at_timestep(steady-1) == g.max_width) {
+      steady--;
+    }
+
+    long period = g.timestep_period();
+    long length = (window_steps + period - 1) / period * period;
+
+    if (steady > 0) {
+      s.schedules.push_back(capture(i, 0, steady));
+      s.windows.push_back(Window{s.schedules.back(), 0});
+    }
+    long t = steady;
+    if (t + length <= g.timesteps) {
+      // Every full window after steady is identical: capture the first.
+      s.schedules.push_back(capture(i, t, length));
+      for (; t + length <= g.timesteps; t += length) {
+        s.windows.push_back(Window{s.schedules.back(), t});
+      }
+    }
+    if (t < g.timesteps) {
+      s.schedules.push_back(capture(i, t, g.timesteps - t));
+      s.windows.push_back(Window{s.schedules.back(), t});
+    }
+
+    long max_tasks = 0;
+    for (auto schedule : s.schedules) {
+      max_tasks = std::max(max_tasks, schedule->tasks());
+    }
+    s.counters = new std::atomic<int>[max_tasks];
+  }
+
+  for (size_t round = 0; ; round++) {
+    Launch launch;
+    launch.tasks = 0;
+    for (unsigned i = 0; i < graphs.size(); i++) {
+      if (round < states[i].windows.size()) {
+        launch.graph_index.push_back(i);
+        launch.base.push_back(launch.tasks);
+        launch.tasks += states[i].windows[round].schedule->tasks();
+      }
+    }
+    if (launch.graph_index.empty()) break;
+    launches.push_back(launch);
+  }
+
+  for (int w = 0; w < nb_workers; w++) {
+    deques.push_back(new WorkDeque<long>());
+  }
+  barrier = new SenseBarrier(nb_workers);
+}
+
+ReplayApp::~ReplayApp()
+{
+  for (auto &s : states) {
+    task_bench_free(s.slab);
+    for (auto schedule : s.schedules) {
+      delete schedule;
+    }
+    delete [] s.counters;
+  }
+  for (auto d : deques) {
+    delete d;
+  }
+  delete barrier;
+  delete scratch;
+}
+
+Schedule *ReplayApp::capture(long graph_index, long start, long timesteps) const
+{
+  const TaskGraph &g = graphs[graph_index];
+  long fields = states[graph_index].fields;
+  long end = start + timesteps;
+
+  Schedule *schedule = new Schedule;
+  schedule->timesteps = timesteps;
+
+  std::vector<long> ids(timesteps * g.max_width, -1);
+  for (long t = start; t < end; t++) {
+    long offset = g.offset_at_timestep(t);
+    long width = g.width_at_timestep(t);
+    for (long p = offset; p < offset + width; p++) {
+      ids[(t - start) * g.max_width + p] = schedule->task_t.size();
+      schedule->task_t.push_back(t - start);
+      schedule->task_p.push_back(p);
+    }
+  }
+  auto id = [&](long t, long p) {
+    return t >= start && t < end ? ids[(t - start) * g.max_width + p] : -1;
+  };
+
+  // Same edges as main.cc, restricted to the window.
+  std::vector<long> succ;
+  schedule->initial.assign(schedule->tasks(), 0);
+  schedule->succ_begin.push_back(0);
+  for (long task = 0; task < schedule->tasks(); task++) {
+    long t = start + schedule->task_t[task];
+    long p = schedule->task_p[task];
+    succ.clear();
+
+    // Consumers of this output.
+    if (t + 1 < end) {
+      long offset = g.offset_at_timestep(t+1);
+      long width = g.width_at_timestep(t+1);
+      for (auto &rdep : g.reverse_dependencies(g.dependence_set_at_timestep(t+1), p)) {
+        for (long q = std::max(rdep.first, offset); q <= std::min(rdep.second, offset + width - 1); q++) {
+          succ.push_back(id(t+1, q));
+        }
+      }
+    }
+
+    // Next writer of this slot.
+    if (valid(g, t + fields, p) && id(t + fields, p) >= 0) {
+      succ.push_back(id(t + fields, p));
+    }
+
+    // Next writers of the slots this task read.
+    if (t > 0) {
+      long offset = g.offset_at_timestep(t-1);
+      long width = g.width_at_timestep(t-1);
+      for (auto &dep : g.dependencies(g.dependence_set_at_timestep(t), p)) {
+        for (long q = std::max(dep.first, offset); q <= std::min(dep.second, offset + width - 1); q++) {
+          if (valid(g, t - 1 + fields, q) && id(t - 1 + fields, q) >= 0) {
+            succ.push_back(id(t - 1 + fields, q));
+          }
+        }
+      }
+    }
+
+    // Next task sharing this point's scratch block.
+    if (point_order) {
+      for (long u = t + 1; u < end; u++) {
+        if (valid(g, u, p)) {
+          succ.push_back(id(u, p));
+          break;
+        }
+      }
+    }
+
+    for (long s : succ) {
+      schedule->succ.push_back(s);
+      schedule->initial[s]++;
+    }
+    schedule->succ_begin.push_back(schedule->succ.size());
+  }
+
+  // Roots go to the worker that first-touched their column.
+  schedule->roots.resize(nb_workers);
+  for (long task = 0; task < schedule->tasks(); task++) {
+    if (schedule->initial[task] == 0) {
+      long owner = schedule->task_p[task] * nb_workers / g.max_width;
+      schedule->roots[owner].push_back(task);
+    }
+  }
+  return schedule;
+}
+
+void ReplayApp::execute_task(int worker, const Launch &launch, long id)
+{
+  size_t entry = launch.base.size() - 1;
+  while (launch.base[entry] > id) {
+    entry--;
+  }
+  long graph_index = launch.graph_index[entry];
+  long task = id - launch.base[entry];
+
+  const TaskGraph &g = graphs[graph_index];
+  GraphState &s = states[graph_index];
+  size_t round = &launch - &launches[0];
+  const Window &window = s.windows[round];
+  const Schedule &schedule = *window.schedule;
+  long t = window.start + schedule.task_t[task];
+  long p = schedule.task_p[task];
+
+  const char **input_ptrs = NULL;
+  size_t *input_bytes = NULL;
+  size_t n_inputs = 0;
+  if (t > 0) {
+    long dset = g.dependence_set_at_timestep(t);
+    size_t max_deps = g.num_dependencies(dset, p);
+    std::pair<long, long> *deps = (std::pair<long, long> *)alloca(sizeof(std::pair<long, long>) * max_deps);
+    size_t num_deps = g.dependencies(dset, p, deps);
+
+    size_t max_inputs = 0;
+    for (size_t span = 0; span < num_deps; span++) {
+      max_inputs += deps[span].second - deps[span].first + 1;
+    }
+    input_ptrs = (const char **)alloca(sizeof(const char *) * max_inputs);
+    input_bytes = (size_t *)alloca(sizeof(size_t) * max_inputs);
+
+    long last_offset = g.offset_at_timestep(t-1);
+    long last_width = g.width_at_timestep(t-1);
+    for (size_t span = 0; span < num_deps; span++) {
+      for (long i = deps[span].first; i <= deps[span].second; i++) {
+        if (i >= last_offset && i < last_offset + last_width) {
+          input_ptrs[n_inputs] = s.tile(t-1, i);
+          input_bytes[n_inputs] = g.output_bytes_per_task;
+          n_inputs++;
+        }
+      }
+    }
+  }
+
+  char *scratch_ptr = scratch->acquire(worker, graph_index, t, p);
+  bound_graphs[graph_index].execute_point(t, p, s.tile(t, p), g.output_bytes_per_task,
+                                          input_ptrs, input_bytes, n_inputs,
+                                          scratch_ptr, g.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
+
+  WorkDeque<long> &deque = *deques[worker];
+  for (long i = schedule.succ_begin[task]; i < schedule.succ_begin[task+1]; i++) {
+    long succ = schedule.succ[i];
+    if (s.counters[succ].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      deque.push(launch.base[entry] + succ);
+    }
+  }
+
+  remaining.fetch_sub(1, std::memory_order_release);
+}
+
+void ReplayApp::prepare_worker(int worker)
+{
+  // Columns are first-touched by a static partition, as in openmp/main.cc.
+  if (alloc_policy.placement == ALLOC_DEFAULT || alloc_policy.placement == ALLOC_FIRST_TOUCH) {
+    for (unsigned i = 0; i < graphs.size(); i++) {
+      long width = graphs[i].max_width;
+      size_t column_bytes = states[i].tile_bytes * states[i].fields;
+      for (long p = worker * width / nb_workers; p < (worker + 1) * width / nb_workers; p++) {
+        task_bench_first_touch(states[i].slab + p * column_bytes, column_bytes);
+      }
+    }
+  }
+  scratch->prepare_worker(worker);
+}
+
+void ReplayApp::worker_thread(int worker)
+{
+  prepare_worker(worker);
+  ready_workers.fetch_add(1);
+  while (!started.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  worker_loop(worker);
+}
+
+void ReplayApp::worker_loop(int worker)
+{
+  WorkDeque<long> &deque = *deques[worker];
+  std::minstd_rand rng(worker + 1);
+
+  for (size_t round = 0; round < launches.size(); round++) {
+    const Launch &launch = launches[round];
+
+    // Reset: each worker restores its share of the counters.
+    for (size_t entry = 0; entry < launch.graph_index.size(); entry++) {
+      GraphState &s = states[launch.graph_index[entry]];
+      const Schedule &schedule = *s.windows[round].schedule;
+      long tasks = schedule.tasks();
+      for (long task = worker * tasks / nb_workers; task < (worker + 1) * tasks / nb_workers; task++) {
+        s.counters[task].store(schedule.initial[task], std::memory_order_relaxed);
+      }
+    }
+    if (worker == 0) {
+      remaining.store(launch.tasks, std::memory_order_relaxed);
+    }
+    barrier->wait(worker);
+
+    for (size_t entry = 0; entry < launch.graph_index.size(); entry++) {
+      const Schedule &schedule = *states[launch.graph_index[entry]].windows[round].schedule;
+      for (long task : schedule.roots[worker]) {
+        deque.push(launch.base[entry] + task);
+      }
+    }
+
+    long id;
+    while (remaining.load(std::memory_order_acquire) > 0) {
+      if (deque.pop(id)) {
+        execute_task(worker, launch, id);
+        continue;
+      }
+      bool stolen = false;
+      for (int attempt = 0; attempt < nb_workers && !stolen; attempt++) {
+        int victim = rng() % nb_workers;
+        if (victim != worker && deques[victim]->steal(id)) {
+          stolen = true;
+        }
+      }
+      if (stolen) {
+        execute_task(worker, launch, id);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    barrier->wait(worker);
+  }
+}
+
+void ReplayApp::execute_main_loop()
+{
+  display();
+
+  std::vector<std::thread> threads;
+  for (int w = 1; w < nb_workers; w++) {
+    threads.emplace_back(&ReplayApp::worker_thread, this, w);
+  }
+  // Worker 0 is this thread.
+  prepare_worker(0);
+  while (ready_workers.load() < nb_workers - 1) {
+    std::this_thread::yield();
+  }
+
+  Timer::time_start();
+  started.store(true, std::memory_order_release);
+  worker_loop(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double elapsed = Timer::time_end();
+
+  report_timing(elapsed);
+  scratch->report_locality(elapsed);
+
+  if (verbose > 0) {
+    for (unsigned i = 0; i < graphs.size(); i++) {
+      printf("Graph %u: %zu schedules captured, %zu windows replayed\n",
+             i, states[i].schedules.size(), states[i].windows.size());
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ReplayApp app(argc, argv);
+  app.execute_main_loop();
+
+  return 0;
+}
@@ -0,0 +1,410 @@
+/* Copyright 2020 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Bulk-synchronous executor on persistent, pinned threads. Timesteps are
+// separated by a spin barrier (sense-reversing or tree), or, with
+// "-barrier flags", by per-point completion flags: a task only waits for
+// the points it reads and for the readers of the slot it overwrites.
+// This is the lower bound for openmp/forall.cc.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "barrier.h"
+#include "core.h"
+#include "timer.h"
+
+enum BarrierKind {
+  BARRIER_SENSE,
+  BARRIER_TREE,
+  BARRIER_FLAGS,
+};
+
+enum PartitionKind {
+  PARTITION_STATIC,
+  PARTITION_DYNAMIC,
+};
+
+struct GraphState {
+  long fields;
+  size_t tile_bytes;
+  char *slab; // column-major, like openmp/main.cc
+  std::vector<SpinFlag> done; // last timestep finished by each point
+
+  char *tile(long t, long p) const
+  {
+    return slab + ((size_t)p * fields + t % fields) * tile_bytes;
+  }
+};
+
+struct WavefrontApp : public App {
+  WavefrontApp(int argc, char **argv);
+  ~WavefrontApp();
+  void execute_main_loop();
+private:
+  void prepare_worker(int worker);
+  void worker_loop(int worker);
+  void worker_thread(int worker);
+  void wait_for_inputs(long graph_index, long t, long p);
+  void execute_point(int worker, long graph_index, long t, long p);
+  void pin(int worker);
+  bool valid(const TaskGraph &g, long t, long p) const
+  {
+    return t >= 0 && t < g.timesteps &&
+           p >= g.offset_at_timestep(t) &&
+           p < g.offset_at_timestep(t) + g.width_at_timestep(t);
+  }
+private:
+  int nb_workers;
+  BarrierKind barrier_kind;
+  PartitionKind partition;
+  long chunk;
+  std::vector<GraphState> states;
+  std::vector<BoundTaskGraph> bound_graphs;
+  std::vector<std::pair<long, long> > order;
+  std::vector<SpinFlag> next_point; // per step, under PARTITION_DYNAMIC
+  SenseBarrier *sense_barrier;
+  TreeBarrier *tree_barrier;
+  ScratchManager *scratch;
+  std::vector<int> cpus;
+  std::atomic<int> ready_workers;
+  std::atomic<bool> started;
+};
+
+WavefrontApp::WavefrontApp(int argc, char **argv)
+  : App(argc, argv)
+  , sense_barrier(NULL)
+  , tree_barrier(NULL)
+  , ready_workers(0)
+  , started(false)
+{
+  nb_workers = 1;
+  barrier_kind = BARRIER_SENSE;
+  partition = PARTITION_STATIC;
+  chunk = 1;
+
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-worker")) {
+      nb_workers = atol(argv[++k]);
+      if (nb_workers <= 0) {
+        fprintf(stderr, "error: Invalid flag \"-worker %d\" must be > 0\n", nb_workers);
+        abort();
+      }
+    }
+    if (!strcmp(argv[k], "-barrier")) {
+      const char *name = argv[++k];
+      if (!strcmp(name, "sense")) {
+        barrier_kind = BARRIER_SENSE;
+      } else if (!strcmp(name, "tree")) {
+        barrier_kind = BARRIER_TREE;
+      } else if (!strcmp(name, "flags")) {
+        barrier_kind = BARRIER_FLAGS;
+      } else {
+        fprintf(stderr, "error: Invalid flag \"-barrier %s\" must be sense, tree or flags\n", name);
+        abort();
+      }
+    }
+    if (!strcmp(argv[k], "-partition")) {
+      const char *name = argv[++k];
+      if (!strcmp(name, "static")) {
+        partition = PARTITION_STATIC;
+      } else if (!strcmp(name, "dynamic")) {
+        partition = PARTITION_DYNAMIC;
+      } else {
+        fprintf(stderr, "error: Invalid flag \"-partition %s\" must be static or dynamic\n", name);
+        abort();
+      }
+    }
+    if (!strcmp(argv[k], "-chunk")) {
+      chunk = atol(argv[++k]);
+      if (chunk <= 0) {
+        fprintf(stderr, "error: Invalid flag \"-chunk %ld\" must be > 0\n", chunk);
+        abort();
+      }
+    }
+  }
+
+  if (barrier_kind == BARRIER_FLAGS && partition == PARTITION_DYNAMIC) {
+    // Flags rely on every point being finished in timestep order.
+    fprintf(stderr, "error: \"-barrier flags\" requires \"-partition static\"\n");
+    abort();
+  }
+
+  order = submission_order();
+  if (partition == PARTITION_DYNAMIC) {
+    next_point.resize(order.size());
+  }
+
+  for (unsigned i = 0; i < graphs.size(); i++) {
+    const TaskGraph &g = graphs[i];
+    bound_graphs.push_back(g.bind());
+
+    states.push_back(GraphState());
+    GraphState &s = states.back();
+    // A single field would make a task's inputs and output alias.
+    s.fields = std::max((long)g.nb_fields, std::min(g.timesteps, 2L));
+    s.tile_bytes = (g.output_bytes_per_task + TASK_BENCH_CACHE_LINE - 1) / TASK_BENCH_CACHE_LINE * TASK_BENCH_CACHE_LINE;
+    s.slab = (char *)task_bench_alloc(s.tile_bytes * s.fields * g.max_width, alloc_policy);
+    if (barrier_kind == BARRIER_FLAGS) {
+      s.done.resize(g.max_width);
+      for (auto &flag : s.done) {
+        flag.value = -1;
+      }
+    }
+  }
+
+  switch (barrier_kind) {
+  case BARRIER_SENSE:
+    sense_barrier = new SenseBarrier(nb_workers);
+    break;
+  case BARRIER_TREE:
+    tree_barrier = new TreeBarrier(nb_workers);
+    break;
+  case BARRIER_FLAGS:
+    break;
+  }
+  scratch = new ScratchManager(*this, nb_workers, SCRATCH_PER_WORKER);
+
+#ifdef __linux__
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+}
+
+WavefrontApp::~WavefrontApp()
+{
+  for (auto &s : states) {
+    task_bench_free(s.slab);
+  }
+  delete sense_barrier;
+  delete tree_barrier;
+  delete scratch;
+}
+
+void WavefrontApp::pin(int worker)
+{
+  // Worker w goes to the w-th CPU we were allowed to run on.
+#ifdef __linux__
+  if (cpus.empty()) return;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpus[worker % cpus.size()], &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+void WavefrontApp::wait_for_inputs(long graph_index, long t, long p)
+{
+  const TaskGraph &g = graphs[graph_index];
+  const GraphState &s = states[graph_index];
+
+  // Points read at timestep t-1.
+  if (t > 0) {
+    long offset = g.offset_at_timestep(t-1);
+    long width = g.width_at_timestep(t-1);
+    for (auto &dep : g.dependencies(g.dependence_set_at_timestep(t), p)) {
+      long first = std::max(dep.first, offset);
+      long last = std::min(dep.second, offset + width - 1);
+      for (long q = first; q <= last; q++) {
+        s.done[q].wait_until(t-1);
+      }
+    }
+  }
+
+  // Readers of the value this task overwrites.
+  long prev = t - s.fields;
+  if (valid(g, prev, p)) {
+    long reader_t = prev + 1;
+    long offset = g.offset_at_timestep(reader_t);
+    long width = g.width_at_timestep(reader_t);
+    for (auto &rdep : g.reverse_dependencies(g.dependence_set_at_timestep(reader_t), p)) {
+      long first = std::max(rdep.first, offset);
+      long last = std::min(rdep.second, offset + width - 1);
+      for (long q = first; q <= last; q++) {
+        s.done[q].wait_until(reader_t);
+      }
+    }
+  }
+}
+
+inline void WavefrontApp::execute_point(int worker, long graph_index, long t, long p)
+{
+  const TaskGraph &g = graphs[graph_index];
+  const GraphState &s = states[graph_index];
+
+  const char **input_ptrs = NULL;
+  size_t *input_bytes = NULL;
+  size_t n_inputs = 0;
+  if (t > 0) {
+    long dset = g.dependence_set_at_timestep(t);
+    size_t max_deps = g.num_dependencies(dset, p);
+    std::pair<long, long> *deps = (std::pair<long, long> *)alloca(sizeof(std::pair<long, long>) * max_deps);
+    size_t num_deps = g.dependencies(dset, p, deps);
+
+    size_t max_inputs = 0;
+    for (size_t span = 0; span < num_deps; span++) {
+      max_inputs += deps[span].second - deps[span].first + 1;
+    }
+    input_ptrs = (const char **)alloca(sizeof(const char *) * max_inputs);
+    input_bytes = (size_t *)alloca(sizeof(size_t) * max_inputs);
+
+    long last_offset = g.offset_at_timestep(t-1);
+    long last_width = g.width_at_timestep(t-1);
+    for (size_t span = 0; span < num_deps; span++) {
+      for (long i = deps[span].first; i <= deps[span].second; i++) {
+        if (i >= last_offset && i < last_offset + last_width) {
+          input_ptrs[n_inputs] = s.tile(t-1, i);
+          input_bytes[n_inputs] = g.output_bytes_per_task;
+          n_inputs++;
+        }
+      }
+    }
+  }
+
+  char *scratch_ptr = scratch->acquire(worker, graph_index, t, p);
+  bound_graphs[graph_index].execute_point(t, p, s.tile(t, p), g.output_bytes_per_task,
+                                          input_ptrs, input_bytes, n_inputs,
+                                          scratch_ptr, g.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
+}
+
+void WavefrontApp::prepare_worker(int worker)
+{
+  pin(worker);
+
+  // Same partition as the static schedule, so each worker touches the
+  // columns it will write.
+  if (alloc_policy.placement == ALLOC_DEFAULT || alloc_policy.placement == ALLOC_FIRST_TOUCH) {
+    for (unsigned i = 0; i < graphs.size(); i++) {
+      long width = graphs[i].max_width;
+      size_t column_bytes = states[i].tile_bytes * states[i].fields;
+      for (long p = worker * width / nb_workers; p < (worker + 1) * width / nb_workers; p++) {
+        task_bench_first_touch(states[i].slab + p * column_bytes, column_bytes);
+      }
+    }
+  }
+  scratch->prepare_worker(worker);
+}
+
+void WavefrontApp::worker_thread(int worker)
+{
+  prepare_worker(worker);
+  ready_workers.fetch_add(1);
+  long spins = 0;
+  while (!started.load(std::memory_order_acquire)) {
+    spin_pause(spins);
+  }
+  worker_loop(worker);
+}
+
+void WavefrontApp::worker_loop(int worker)
+{
+  for (size_t step = 0; step < order.size(); step++) {
+    long i = order[step].first;
+    long t = order[step].second;
+    const TaskGraph &g = graphs[i];
+    long offset = g.offset_at_timestep(t);
+    long width = g.width_at_timestep(t);
+
+    if (partition == PARTITION_STATIC) {
+      // Partition max_width rather than the active points so that a
+      // point always stays with the worker that first touched it.
+      long first = worker * g.max_width / nb_workers;
+      long last = (worker + 1) * g.max_width / nb_workers;
+      for (long p = first; p < last; p++) {
+        if (p >= offset && p < offset + width) {
+          if (barrier_kind == BARRIER_FLAGS) {
+            wait_for_inputs(i, t, p);
+          }
+          execute_point(worker, i, t, p);
+        }
+        if (barrier_kind == BARRIER_FLAGS) {
+          states[i].done[p].value.store(t, std::memory_order_release);
+        }
+      }
+    } else {
+      std::atomic<long> &next = next_point[step].value;
+      for (long p = next.fetch_add(chunk, std::memory_order_relaxed); p < width;
+           p = next.fetch_add(chunk, std::memory_order_relaxed)) {
+        for (long x = p; x < std::min(p + chunk, width); x++) {
+          execute_point(worker, i, t, offset + x);
+        }
+      }
+    }
+
+    switch (barrier_kind) {
+    case BARRIER_SENSE:
+      sense_barrier->wait(worker);
+      break;
+    case BARRIER_TREE:
+      tree_barrier->wait(worker);
+      break;
+    case BARRIER_FLAGS:
+      break;
+    }
+  }
+}
+
+void WavefrontApp::execute_main_loop()
+{
+  display();
+
+  std::vector<std::thread> threads;
+  for (int w = 1; w < nb_workers; w++) {
+    threads.emplace_back(&WavefrontApp::worker_thread, this, w);
+  }
+  // Worker 0 is this thread.
+  prepare_worker(0);
+  while (ready_workers.load() < nb_workers - 1) {
+    std::this_thread::yield();
+  }
+
+  Timer::time_start();
+  started.store(true, std::memory_order_release);
+  worker_loop(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double elapsed = Timer::time_end();
+
+  report_timing(elapsed);
+  scratch->report_locality(elapsed);
+}
+
+int main(int argc, char **argv)
+{
+  WavefrontApp app(argc, argv);
+  app.execute_main_loop();
+
+  return 0;
+}
@@ -0,0 +1,263 @@
+/* Copyright 2020 Los Alamos National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Bulk-synchronous variant of main.cc: every timestep is one parallel
+// loop over its points, with a barrier in between. Uses the same tile
+// layout as main.cc so that the two can be compared directly.
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <omp.h>
+#include "core.h"
+#include "timer.h"
+
+typedef struct tile_s {
+  char *output_buff;
+}tile_t;
+
+typedef struct matrix_s {
+  tile_t *data;
+  char *slab; // backs every output_buff, column-major
+  size_t tile_bytes; // output_bytes_per_task rounded up to a cache line
+  int M;
+  int N;
+}matrix_t;
+
+enum LoopSchedule {
+  LOOP_STATIC,
+  LOOP_DYNAMIC,
+  LOOP_GUIDED,
+  LOOP_TASKLOOP,
+};
+
+struct OpenMPForallApp : public App {
+  OpenMPForallApp(int argc, char **argv);
+  ~OpenMPForallApp();
+  void execute_main_loop();
+private:
+  void execute_point(size_t idx, long t, long x);
+private:
+  int nb_workers;
+  LoopSchedule schedule;
+  int chunk; // chunk size for omp for, grainsize for taskloop; 0 = default
+  matrix_t *matrix;
+  BoundTaskGraph *bound_graphs;
+  ScratchManager *scratch;
+};
+
+OpenMPForallApp::OpenMPForallApp(int argc, char **argv)
+  : App(argc, argv)
+{
+  nb_workers = 1;
+  schedule = LOOP_STATIC;
+  chunk = 0;
+
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "-worker")) {
+      nb_workers = atol(argv[++k]);
+    }
+    if (!strcmp(argv[k], "-schedule")) {
+      const char *name = argv[++k];
+      if (!strcmp(name, "static")) {
+        schedule = LOOP_STATIC;
+      } else if (!strcmp(name, "dynamic")) {
+        schedule = LOOP_DYNAMIC;
+      } else if (!strcmp(name, "guided")) {
+        schedule = LOOP_GUIDED;
+      } else if (!strcmp(name, "taskloop")) {
+        schedule = LOOP_TASKLOOP;
+      } else {
+        fprintf(stderr, "error: Invalid flag \"-schedule %s\" must be static, dynamic, guided or taskloop\n", name);
+        abort();
+      }
+    }
+    if (!strcmp(argv[k], "-chunk")) {
+      chunk = atoi(argv[++k]);
+      if (chunk < 0) {
+        fprintf(stderr, "error: Invalid flag \"-chunk %d\" must be >= 0\n", chunk);
+        abort();
+      }
+    }
+  }
+
+  matrix = (matrix_t *)malloc(sizeof(matrix_t) * graphs.size());
+  bound_graphs = (BoundTaskGraph *)malloc(sizeof(BoundTaskGraph) * graphs.size());
+
+  for (unsigned i = 0; i < graphs.size(); i++) {
+    TaskGraph &graph = graphs[i];
+    bound_graphs[i] = graph.bind();
+
+    matrix[i].M = graph.nb_fields;
+    matrix[i].N = graph.max_width;
+    matrix[i].data = (tile_t*)malloc(sizeof(tile_t) * matrix[i].M * matrix[i].N);
+
+    // One slab per graph. Each tile is padded to a cache line so that
+    // neighboring points never share one, and the tiles of a column are
+    // adjacent so that a column's pages can be placed with its owner.
+    size_t tile_bytes = (graph.output_bytes_per_task + TASK_BENCH_CACHE_LINE - 1) / TASK_BENCH_CACHE_LINE * TASK_BENCH_CACHE_LINE;
+    matrix[i].tile_bytes = tile_bytes;
+    matrix[i].slab = (char *)task_bench_alloc(tile_bytes * matrix[i].M * matrix[i].N, alloc_policy);
+    for (int x = 0; x < matrix[i].N; x++) {
+      for (int y = 0; y < matrix[i].M; y++) {
+        matrix[i].data[y * matrix[i].N + x].output_buff = matrix[i].slab + ((size_t)x * matrix[i].M + y) * tile_bytes;
+      }
+    }
+  }
+
+  scratch = new ScratchManager(*this, nb_workers, SCRATCH_PER_WORKER);
+
+  omp_set_num_threads(nb_workers);
+  switch (schedule) {
+  case LOOP_STATIC:
+    omp_set_schedule(omp_sched_static, chunk);
+    break;
+  case LOOP_DYNAMIC:
+    omp_set_schedule(omp_sched_dynamic, chunk);
+    break;
+  case LOOP_GUIDED:
+    omp_set_schedule(omp_sched_guided, chunk);
+    break;
+  case LOOP_TASKLOOP:
+    break;
+  }
+
+  #pragma omp parallel
+  {
+    scratch->prepare_worker(omp_get_thread_num());
+  }
+
+  // With a static schedule this is exactly the worker that owns the column.
+  // Other placements were already faulted in by task_bench_alloc.
+  if (alloc_policy.placement == ALLOC_DEFAULT || alloc_policy.placement == ALLOC_FIRST_TOUCH) {
+    for (unsigned i = 0; i < graphs.size(); i++) {
+      size_t column_bytes = matrix[i].tile_bytes * matrix[i].M;
+      #pragma omp parallel for schedule(runtime)
+      for (int x = 0; x < matrix[i].N; x++) {
+        task_bench_first_touch(matrix[i].slab + x * column_bytes, column_bytes);
+      }
+    }
+  }
+}
+
+OpenMPForallApp::~OpenMPForallApp()
+{
+  for (unsigned i = 0; i < graphs.size(); i++) {
+    task_bench_free(matrix[i].slab);
+    free(matrix[i].data);
+  }
+  free(matrix);
+  free(bound_graphs);
+
+  delete scratch;
+}
+
+inline void OpenMPForallApp::execute_point(size_t idx, long t, long x)
+{
+  const TaskGraph &graph = graphs[idx];
+  const matrix_t &mat = matrix[idx];
+  int tid = omp_get_thread_num();
+
+  const char **input_ptrs = NULL;
+  size_t *input_bytes = NULL;
+  size_t n_inputs = 0;
+  if (t > 0) {
+    long dset = graph.dependence_set_at_timestep(t);
+    size_t max_deps = graph.num_dependencies(dset, x);
+    std::pair<long, long> *deps = (std::pair<long, long> *)alloca(sizeof(std::pair<long, long>) * max_deps);
+    size_t num_deps = graph.dependencies(dset, x, deps);
+
+    size_t max_inputs = 0;
+    for (size_t span = 0; span < num_deps; span++) {
+      max_inputs += deps[span].second - deps[span].first + 1;
+    }
+    input_ptrs = (const char **)alloca(sizeof(const char *) * max_inputs);
+    input_bytes = (size_t *)alloca(sizeof(size_t) * max_inputs);
+
+    long last_offset = graph.offset_at_timestep(t-1);
+    long last_width = graph.width_at_timestep(t-1);
+    int y = (t-1) % graph.nb_fields;
+    for (size_t span = 0; span < num_deps; span++) {
+      for (long i = deps[span].first; i <= deps[span].second; i++) {
+        if (i >= last_offset && i < last_offset + last_width) {
+          input_ptrs[n_inputs] = mat.data[y * mat.N + i].output_buff;
+          input_bytes[n_inputs] = graph.output_bytes_per_task;
+          n_inputs++;
+        }
+      }
+    }
+  }
+
+  tile_t &out = mat.data[(t % graph.nb_fields) * mat.N + x];
+  char *scratch_ptr = scratch->acquire(tid, idx, t, x);
+  bound_graphs[idx].execute_point(t, x, out.output_buff, graph.output_bytes_per_task,
+                                  input_ptrs, input_bytes, n_inputs,
+                                  scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
+}
+
+void OpenMPForallApp::execute_main_loop()
+{
+  display();
+  std::vector<std::pair<long, long> > order = submission_order();
+
+  Timer::time_start();
+
+  #pragma omp parallel
+  {
+    for (auto &step : order) {
+      size_t i = step.first;
+      long t = step.second;
+      long offset = graphs[i].offset_at_timestep(t);
+      long width = graphs[i].width_at_timestep(t);
+
+      if (schedule == LOOP_TASKLOOP) {
+        // The taskloop's implicit taskgroup and the end of single
+        // together act as the barrier between timesteps.
+        #pragma omp single
+        {
+          if (chunk > 0) {
+            #pragma omp taskloop grainsize(chunk)
+            for (long x = offset; x < offset + width; x++) {
+              execute_point(i, t, x);
+            }
+          } else {
+            #pragma omp taskloop
+            for (long x = offset; x < offset + width; x++) {
+              execute_point(i, t, x);
+            }
+          }
+        }
+      } else {
+        #pragma omp for schedule(runtime)
+        for (long x = offset; x < offset + width; x++) {
+          execute_point(i, t, x);
+        }
+      }
+    }
+  }
+
+  double elapsed = Timer::time_end();
+  report_timing(elapsed);
+  scratch->report_locality(elapsed);
+}
+
+int main(int argc, char **argv)
+{
+  OpenMPForallApp app(argc, argv);
+  app.execute_main_loop();
+
+  return 0;
+}
@@ -24,10 +24,6 @@
 
 #define VERBOSE_LEVEL 0
 
-#define USE_CORE_VERIFICATION
-
-#define MAX_NUM_ARGS 10
-
 typedef struct tile_s {
   float dep;
   char *output_buff;
@@ -36,7 +32,7 @@ typedef struct tile_s {
 typedef struct payload_s {
   int x;
   int y;
-  TaskGraph graph;
+  int graph_id;
 }payload_t;
 
 typedef struct task_args_s {
@@ -46,286 +42,63 @@ typedef struct task_args_s {
 
 typedef struct matrix_s {
   tile_t *data;
+  char *slab; // backs every output_buff, column-major
+  size_t tile_bytes; // output_bytes_per_task rounded up to a cache line
+  char *point_token; // under -point-resident, orders the tasks of a point
   int M;
   int N;
 }matrix_t;
 
-char **extra_local_memory;
-
-static inline void task1(tile_t *tile_out, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_out->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else  
-  tile_out->dep = 0;
-  printf("Task1 tid %d, x %d, y %d, out %f\n", tid, payload.x, payload.y, tile_out->dep);
-#endif  
-}
-
-static inline void task2(tile_t *tile_out, tile_t *tile_in1, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else  
-  tile_out->dep = tile_in1->dep + 1;
-  printf("Task2 tid %d, x %d, y %d, out %f, in1 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep);
-#endif
-}
-
-static inline void task3(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in2->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                     input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else  
-  tile_out->dep = tile_in1->dep + tile_in2->dep + 1;
-  printf("Task3 tid %d, x %d, y %d, out %f, in1 %f, in2 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep);
-#endif
-}
-
-static inline void task4(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, tile_t *tile_in3, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in2->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in3->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else
-  tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + 1;
-  printf("Task4 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep);
-#endif
-}
-
-static inline void task5(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, tile_t *tile_in3, tile_t *tile_in4, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in2->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in3->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in4->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else
-  tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + 1;
-  printf("Task5 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep);
-#endif
-}
-
-static inline void task6(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, tile_t *tile_in3, tile_t *tile_in4, tile_t *tile_in5, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in2->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in3->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in4->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in5->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else
-  tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + 1;
-  printf("Task6 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep, tile_in5->dep);
-#endif
-}
-
-static inline void task7(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, tile_t *tile_in3, tile_t *tile_in4, tile_t *tile_in5, tile_t *tile_in6, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in2->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in3->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in4->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in5->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in6->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else
-  tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + 1;
-  printf("Task7 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f\n", 
-    tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep, tile_in5->dep, tile_in6->dep);
-#endif
-}
-
-static inline void task8(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, tile_t *tile_in3, tile_t *tile_in4, tile_t *tile_in5, tile_t *tile_in6, tile_t *tile_in7, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in2->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in3->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in4->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in5->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in6->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in7->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else
-  tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + 1;
-  printf("Task8 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f\n", 
-    tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep, tile_in5->dep, tile_in6->dep, tile_in7->dep);
-#endif
-}
-
-static inline void task9(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, tile_t *tile_in3, tile_t *tile_in4, tile_t *tile_in5, tile_t *tile_in6, tile_t *tile_in7, tile_t *tile_in8, payload_t payload)
-{
-  int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in2->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in3->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in4->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in5->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in6->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in7->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in8->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else
-  tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + tile_in8->dep + 1;
-  printf("Task9 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f, in8 %f\n", 
-    tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep, tile_in5->dep, tile_in6->dep, tile_in7->dep, tile_in8->dep);
-#endif
-}
+ScratchManager *scratch = NULL;
+matrix_t *matrix = NULL;
+BoundTaskGraph *bound_graphs = NULL;
 
-static inline void task10(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, tile_t *tile_in3, tile_t *tile_in4, tile_t *tile_in5, tile_t *tile_in6, tile_t *tile_in7, tile_t *tile_in8, tile_t *tile_in9, payload_t payload)
+// Inputs are recomputed from the graph inside the task rather than
+// captured at creation, so a task needs no per-task storage whatever its
+// number of dependencies.
+static inline void task_body(tile_t *tile_out, payload_t payload)
 {
   int tid = omp_get_thread_num();
-#if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
-  char *output_ptr = (char*)tile_out->output_buff;
-  size_t output_bytes= graph.output_bytes_per_task;
-  std::vector<const char *> input_ptrs;
-  std::vector<size_t> input_bytes;
-  input_ptrs.push_back((char*)tile_in1->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in2->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in3->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in4->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in5->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in6->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in7->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in8->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
-  input_ptrs.push_back((char*)tile_in9->output_buff);
-  input_bytes.push_back(graph.output_bytes_per_task);
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
+  const matrix_t &mat = matrix[payload.graph_id];
+  long t = payload.y;
+  long x = payload.x;
+
+  const char **input_ptrs = NULL;
+  size_t *input_bytes = NULL;
+  size_t n_inputs = 0;
+  if (t > 0) {
+    long dset = graph.dependence_set_at_timestep(t);
+    size_t max_deps = graph.num_dependencies(dset, x);
+    std::pair<long, long> *deps = (std::pair<long, long> *)alloca(sizeof(std::pair<long, long>) * max_deps);
+    size_t num_deps = graph.dependencies(dset, x, deps);
+
+    size_t max_inputs = 0;
+    for (size_t span = 0; span < num_deps; span++) {
+      max_inputs += deps[span].second - deps[span].first + 1;
+    }
+    input_ptrs = (const char **)alloca(sizeof(const char *) * max_inputs);
+    input_bytes = (size_t *)alloca(sizeof(size_t) * max_inputs);
+
+    long last_offset = graph.offset_at_timestep(t-1);
+    long last_width = graph.width_at_timestep(t-1);
+    int y = (t-1) % graph.nb_fields;
+    for (size_t span = 0; span < num_deps; span++) {
+      for (long i = deps[span].first; i <= deps[span].second; i++) {
+        if (i >= last_offset && i < last_offset + last_width) {
+          input_ptrs[n_inputs] = mat.data[y * mat.N + i].output_buff;
+          input_bytes[n_inputs] = graph.output_bytes_per_task;
+          n_inputs++;
+        }
+      }
+    }
+  }
 
-  graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid], graph.scratch_bytes_per_task);
-#else
-  tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + tile_in8->dep + tile_in9->dep + 1;
-  printf("Task10 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f, in8 %f, in9 %f\n", 
-    tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep, tile_in5->dep, tile_in6->dep, tile_in7->dep, tile_in8->dep, tile_in9->dep);
-#endif
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, t, x);
+  bound_graphs[payload.graph_id].execute_point(t, x, tile_out->output_buff, graph.output_bytes_per_task,
+                                               input_ptrs, input_bytes, n_inputs,
+                                               scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 }
 
 struct OpenMPApp : public App {
@@ -338,11 +111,10 @@ private:
   void debug_printf(int verbose_level, const char *format, ...);
 private:
   int nb_workers;
+  std::vector<task_args_t> args_buffer;
 //  matrix_t *matrix;
 };
 
-matrix_t *matrix = NULL;
-
 OpenMPApp::OpenMPApp(int argc, char **argv)
   : App(argc, argv)
 { 
@@ -356,46 +128,54 @@ OpenMPApp::OpenMPApp(int argc, char **argv)
   
   matrix = (matrix_t *)malloc(sizeof(matrix_t) * graphs.size());
   
-  size_t max_scratch_bytes_per_task = 0;
+  bound_graphs = (BoundTaskGraph *)malloc(sizeof(BoundTaskGraph) * graphs.size());
   
   for (unsigned i = 0; i < graphs.size(); i++) {
     TaskGraph &graph = graphs[i];
+    bound_graphs[i] = graph.bind();
     
     matrix[i].M = graph.nb_fields;
     matrix[i].N = graph.max_width;
     matrix[i].data = (tile_t*)malloc(sizeof(tile_t) * matrix[i].M * matrix[i].N);
-  
-    for (int j = 0; j < matrix[i].M * matrix[i].N; j++) {
-      matrix[i].data[j].output_buff = (char *)malloc(sizeof(char) * graph.output_bytes_per_task);
-    }
-    
-    if (graph.scratch_bytes_per_task > max_scratch_bytes_per_task) {
-      max_scratch_bytes_per_task = graph.scratch_bytes_per_task;
+    matrix[i].point_token = (char *)malloc(matrix[i].N);
+
+    // One slab per graph. Each tile is padded to a cache line so that
+    // neighboring points never share one, and the tiles of a column are
+    // adjacent so that a column's pages can be placed with its owner.
+    size_t tile_bytes = (graph.output_bytes_per_task + TASK_BENCH_CACHE_LINE - 1) / TASK_BENCH_CACHE_LINE * TASK_BENCH_CACHE_LINE;
+    matrix[i].tile_bytes = tile_bytes;
+    matrix[i].slab = (char *)task_bench_alloc(tile_bytes * matrix[i].M * matrix[i].N, alloc_policy);
+    for (int x = 0; x < matrix[i].N; x++) {
+      for (int y = 0; y < matrix[i].M; y++) {
+        matrix[i].data[y * matrix[i].N + x].output_buff = matrix[i].slab + ((size_t)x * matrix[i].M + y) * tile_bytes;
+      }
     }
     
     printf("graph id %d, M = %d, N = %d, data %p, nb_fields %d\n", i, matrix[i].M, matrix[i].N, matrix[i].data, graph.nb_fields);
   }
   
-  extra_local_memory = (char**)malloc(sizeof(char*) * nb_workers);
-  assert(extra_local_memory != NULL);
-  for (int k = 0; k < nb_workers; k++) {
-    if (max_scratch_bytes_per_task > 0) {
-      extra_local_memory[k] = (char*)malloc(sizeof(char)*max_scratch_bytes_per_task);
-      TaskGraph::prepare_scratch(extra_local_memory[k], sizeof(char)*max_scratch_bytes_per_task);
-    } else {
-      extra_local_memory[k] = NULL;
-    }
-  }
+  scratch = new ScratchManager(*this, nb_workers, SCRATCH_PER_WORKER);
   
  // omp_set_dynamic(1);
   omp_set_num_threads(nb_workers);
   
-  if (max_scratch_bytes_per_task > 0) {
-    #pragma omp parallel
-    {
-      int tid = omp_get_thread_num();
-      //printf("im tid %d\n", tid);
-      TaskGraph::prepare_scratch(extra_local_memory[tid], sizeof(char)*max_scratch_bytes_per_task);
+  #pragma omp parallel
+  {
+    int tid = omp_get_thread_num();
+    //printf("im tid %d\n", tid);
+    scratch->prepare_worker(tid);
+  }
+
+  // Columns are touched by the worker that a static schedule would give
+  // them to; that is the best guess at the owner without affinity hints.
+  // Other placements were already faulted in by task_bench_alloc.
+  if (alloc_policy.placement == ALLOC_DEFAULT || alloc_policy.placement == ALLOC_FIRST_TOUCH) {
+    for (unsigned i = 0; i < graphs.size(); i++) {
+      size_t column_bytes = matrix[i].tile_bytes * matrix[i].M;
+      #pragma omp parallel for schedule(static)
+      for (int x = 0; x < matrix[i].N; x++) {
+        task_bench_first_touch(matrix[i].slab + x * column_bytes, column_bytes);
+      }
     }
   }
 
@@ -404,30 +184,28 @@ OpenMPApp::OpenMPApp(int argc, char **argv)
 OpenMPApp::~OpenMPApp()
 {
   for (unsigned i = 0; i < graphs.size(); i++) {
-    for (int j = 0; j < matrix[i].M * matrix[i].N; j++) {
-      free(matrix[i].data[j].output_buff);
-      matrix[i].data[j].output_buff = NULL;
-    }
+    task_bench_free(matrix[i].slab);
+    matrix[i].slab = NULL;
     free(matrix[i].data);
     matrix[i].data = NULL;
+    free(matrix[i].point_token);
+    matrix[i].point_token = NULL;
   }
   
   free(matrix);
   matrix = NULL;
   
-  for (int j = 0; j < nb_workers; j++) {
-    if (extra_local_memory[j] != NULL) {
-      free(extra_local_memory[j]);
-      extra_local_memory[j] = NULL;
-    }
-  }
-  free(extra_local_memory);
-  extra_local_memory = NULL;
+  free(bound_graphs);
+  bound_graphs = NULL;
+  
+  delete scratch;
+  scratch = NULL;
 }
 
 void OpenMPApp::execute_main_loop()
 { 
   display();
+  std::vector<std::pair<long, long> > order = submission_order();
   
   Timer::time_start();
   // parallel在上面
@@ -436,12 +214,8 @@ void OpenMPApp::execute_main_loop()
   {
     #pragma omp master
     {
-      for (unsigned i = 0; i < graphs.size(); i++) {
-        const TaskGraph &g = graphs[i];
-        for (int y = 0; y < g.timesteps; y++) {
-          execute_timestep(i, y);
-        }
-        
+      for (auto &step : order) {
+        execute_timestep(step.first, step.second);
       }
 //      #pragma omp taskwait
     }
@@ -450,6 +224,7 @@ void OpenMPApp::execute_main_loop()
   
   double elapsed = Timer::time_end();
   report_timing(elapsed);
+  scratch->report_locality(elapsed);
 }
 
 void OpenMPApp::execute_timestep(size_t idx, long t)
@@ -460,7 +235,6 @@ void OpenMPApp::execute_timestep(size_t idx, long t)
   long dset = g.dependence_set_at_timestep(t);
   int nb_fields = g.nb_fields;
   
-  task_args_t args[MAX_NUM_ARGS];
   payload_t payload;
   int num_args = 0;
   int ct = 0;  
@@ -470,6 +244,15 @@ void OpenMPApp::execute_timestep(size_t idx, long t)
     num_args = 0;
     ct = 0;    
     
+    size_t max_num_args = 1;
+    for (std::pair<long, long> dep : deps) {
+      max_num_args += dep.second - dep.first + 1;
+    }
+    if (args_buffer.size() < max_num_args) {
+      args_buffer.resize(max_num_args);
+    }
+    task_args_t *args = args_buffer.data();
+    
     if (deps.size() == 0) {
       num_args = 1;
       debug_printf(1, "%d[%d] ", x, num_args);
@@ -510,7 +293,7 @@ void OpenMPApp::execute_timestep(size_t idx, long t)
     
     payload.y = t;
     payload.x = x;
-    payload.graph = g;
+    payload.graph_id = g.graph_index;
     insert_task(args, num_args, payload, idx);
   }
 }
@@ -518,218 +301,19 @@ void OpenMPApp::execute_timestep(size_t idx, long t)
 void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload, size_t graph_id)
 {
   tile_t *mat = matrix[graph_id].data;
+  int N = matrix[graph_id].N;
   int x0 = args[0].x;
   int y0 = args[0].y;
-//  printf("x %d, y %d, mat %p\n", x0, y0, mat);
-  switch(num_args) {
-  case 1:
-  {
-    #pragma omp task depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task1(&mat[y0 * matrix[graph_id].N + x0], payload);
-    break;
-  }
-  
-  case 2: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task2(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], payload);
-    break;
-  }
-  
-  case 3: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    int x2 = args[2].x;
-    int y2 = args[2].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task3(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], 
-            &mat[y2 * matrix[graph_id].N + x2], payload);
-    break;
-  }
-  
-  case 4: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    int x2 = args[2].x;
-    int y2 = args[2].y;
-    int x3 = args[3].x;
-    int y3 = args[3].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task4(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], 
-            &mat[y2 * matrix[graph_id].N + x2], 
-            &mat[y3 * matrix[graph_id].N + x3], payload);
-    break;
-  }
-  
-  case 5: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    int x2 = args[2].x;
-    int y2 = args[2].y;
-    int x3 = args[3].x;
-    int y3 = args[3].y;
-    int x4 = args[4].x;
-    int y4 = args[4].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task5(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], 
-            &mat[y2 * matrix[graph_id].N + x2], 
-            &mat[y3 * matrix[graph_id].N + x3], 
-            &mat[y4 * matrix[graph_id].N + x4], payload);
-    break;
-  }
-  
-  case 6: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    int x2 = args[2].x;
-    int y2 = args[2].y;
-    int x3 = args[3].x;
-    int y3 = args[3].y;
-    int x4 = args[4].x;
-    int y4 = args[4].y;
-    int x5 = args[5].x;
-    int y5 = args[5].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task6(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], 
-            &mat[y2 * matrix[graph_id].N + x2], 
-            &mat[y3 * matrix[graph_id].N + x3], 
-            &mat[y4 * matrix[graph_id].N + x4], 
-            &mat[y5 * matrix[graph_id].N + x5], payload);
-    break;
+  if (point_resident) {
+    // The point's scratch block is read and updated every timestep, so
+    // consecutive tasks of a point must not overlap even when the
+    // pattern has no self-dependency.
+    #pragma omp task depend(iterator(it = 1:num_args), in: mat[args[it].y * N + args[it].x]) depend(inout: mat[y0 * N + x0]) depend(inout: matrix[graph_id].point_token[x0]) firstprivate(payload) untied mergeable
+      task_body(&mat[y0 * N + x0], payload);
+  } else {
+    #pragma omp task depend(iterator(it = 1:num_args), in: mat[args[it].y * N + args[it].x]) depend(inout: mat[y0 * N + x0]) firstprivate(payload) untied mergeable
+      task_body(&mat[y0 * N + x0], payload);
   }
-  
-  case 7: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    int x2 = args[2].x;
-    int y2 = args[2].y;
-    int x3 = args[3].x;
-    int y3 = args[3].y;
-    int x4 = args[4].x;
-    int y4 = args[4].y;
-    int x5 = args[5].x;
-    int y5 = args[5].y;
-    int x6 = args[6].x;
-    int y6 = args[6].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task7(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], 
-            &mat[y2 * matrix[graph_id].N + x2], 
-            &mat[y3 * matrix[graph_id].N + x3], 
-            &mat[y4 * matrix[graph_id].N + x4], 
-            &mat[y5 * matrix[graph_id].N + x5], 
-            &mat[y6 * matrix[graph_id].N + x6], payload);
-    break;
-  }
-  
-  case 8: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    int x2 = args[2].x;
-    int y2 = args[2].y;
-    int x3 = args[3].x;
-    int y3 = args[3].y;
-    int x4 = args[4].x;
-    int y4 = args[4].y;
-    int x5 = args[5].x;
-    int y5 = args[5].y;
-    int x6 = args[6].x;
-    int y6 = args[6].y;
-    int x7 = args[7].x;
-    int y7 = args[7].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task8(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], 
-            &mat[y2 * matrix[graph_id].N + x2], 
-            &mat[y3 * matrix[graph_id].N + x3], 
-            &mat[y4 * matrix[graph_id].N + x4], 
-            &mat[y5 * matrix[graph_id].N + x5], 
-            &mat[y6 * matrix[graph_id].N + x6], 
-            &mat[y7 * matrix[graph_id].N + x7], payload);
-    break;
-  }
-  
-  case 9: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    int x2 = args[2].x;
-    int y2 = args[2].y;
-    int x3 = args[3].x;
-    int y3 = args[3].y;
-    int x4 = args[4].x;
-    int y4 = args[4].y;
-    int x5 = args[5].x;
-    int y5 = args[5].y;
-    int x6 = args[6].x;
-    int y6 = args[6].y;
-    int x7 = args[7].x;
-    int y7 = args[7].y;
-    int x8 = args[8].x;
-    int y8 = args[8].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task9(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], 
-            &mat[y2 * matrix[graph_id].N + x2], 
-            &mat[y3 * matrix[graph_id].N + x3], 
-            &mat[y4 * matrix[graph_id].N + x4], 
-            &mat[y5 * matrix[graph_id].N + x5], 
-            &mat[y6 * matrix[graph_id].N + x6], 
-            &mat[y7 * matrix[graph_id].N + x7], 
-            &mat[y8 * matrix[graph_id].N + x8], payload);
-    break;
-  }
-  
-  case 10: 
-  {
-    int x1 = args[1].x;
-    int y1 = args[1].y;
-    int x2 = args[2].x;
-    int y2 = args[2].y;
-    int x3 = args[3].x;
-    int y3 = args[3].y;
-    int x4 = args[4].x;
-    int y4 = args[4].y;
-    int x5 = args[5].x;
-    int y5 = args[5].y;
-    int x6 = args[6].x;
-    int y6 = args[6].y;
-    int x7 = args[7].x;
-    int y7 = args[7].y;
-    int x8 = args[8].x;
-    int y8 = args[8].y;
-    int x9 = args[9].x;
-    int y9 = args[9].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(in: mat[y9 * matrix[graph_id].N + x9]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
-      task10(&mat[y0 * matrix[graph_id].N + x0], 
-            &mat[y1 * matrix[graph_id].N + x1], 
-            &mat[y2 * matrix[graph_id].N + x2], 
-            &mat[y3 * matrix[graph_id].N + x3], 
-            &mat[y4 * matrix[graph_id].N + x4], 
-            &mat[y5 * matrix[graph_id].N + x5], 
-            &mat[y6 * matrix[graph_id].N + x6], 
-            &mat[y7 * matrix[graph_id].N + x7], 
-            &mat[y8 * matrix[graph_id].N + x8], 
-            &mat[y9 * matrix[graph_id].N + x9], payload);
-    break;
-  }
-  
-  default:
-    assert(false && "unexpected num_args");
-  };
 }
 
 void OpenMPApp::debug_printf(int verbose_level, const char *format, ...)
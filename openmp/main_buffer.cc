@@ -37,7 +37,6 @@ typedef struct payload_s {
   int graph_id;
   int x;
   int y;
-  TaskGraph graph;
 }payload_t;
 
 typedef struct task_args_s {
@@ -49,15 +48,24 @@ typedef struct matrix_s {
   tile_t *data;
   int M;
   int N;
+  char *point_token; // one byte per point, see point_order_token
 }matrix_t;
 
-char** extra_local_memory[10];
+ScratchManager *scratch = NULL;
+
+// Dependence object ordering a task after the previous task of its point.
+// Under SCRATCH_PER_POINT those tasks share one scratch block; otherwise the
+// tile's own output buffer is returned, which orders nothing new.
+static inline char *point_order_token(matrix_t &m, tile_t *tile, int x)
+{
+  return scratch->policy() == SCRATCH_PER_POINT ? &m.point_token[x] : tile->output_buff;
+}
 
 static inline void task1(tile_t *tile_out, payload_t payload)
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -65,8 +73,10 @@ static inline void task1(tile_t *tile_out, payload_t payload)
   input_ptrs.push_back((char*)tile_out->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
   
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else  
   tile_out->dep = 0;
   printf("Task1 tid %d, x %d, y %d, out %f\n", tid, payload.x, payload.y, tile_out->dep);
@@ -77,7 +87,7 @@ static inline void task2(tile_t *tile_out, tile_t *tile_in1, payload_t payload)
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -85,8 +95,10 @@ static inline void task2(tile_t *tile_out, tile_t *tile_in1, payload_t payload)
   input_ptrs.push_back((char*)tile_in1->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
   
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else  
   tile_out->dep = tile_in1->dep + 1;
   printf("Task2 tid %d, x %d, y %d, out %f, in1 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep);
@@ -97,7 +109,7 @@ static inline void task3(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, p
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -107,8 +119,10 @@ static inline void task3(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, p
   input_ptrs.push_back((char*)tile_in2->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                     input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                     input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else  
   tile_out->dep = tile_in1->dep + tile_in2->dep + 1;
   printf("Task3 tid %d, x %d, y %d, out %f, in1 %f, in2 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep);
@@ -119,7 +133,7 @@ static inline void task4(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -131,8 +145,10 @@ static inline void task4(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in3->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + 1;
   printf("Task4 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep);
@@ -143,7 +159,7 @@ static inline void task5(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -157,8 +173,10 @@ static inline void task5(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in4->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + 1;
   printf("Task5 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep);
@@ -169,7 +187,7 @@ static inline void task6(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -185,8 +203,10 @@ static inline void task6(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in5->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + 1;
   printf("Task6 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep, tile_in5->dep);
@@ -197,7 +217,7 @@ static inline void task7(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -215,8 +235,10 @@ static inline void task7(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in6->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + 1;
   printf("Task7 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f\n", 
@@ -228,7 +250,7 @@ static inline void task8(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -248,8 +270,10 @@ static inline void task8(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in7->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + 1;
   printf("Task8 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f\n", 
@@ -261,7 +285,7 @@ static inline void task9(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -283,8 +307,10 @@ static inline void task9(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in8->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + tile_in8->dep + 1;
   printf("Task9 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f, in8 %f\n", 
@@ -296,7 +322,7 @@ static inline void task10(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2,
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -320,8 +346,10 @@ static inline void task10(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2,
   input_ptrs.push_back((char*)tile_in9->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[payload.graph_id][payload.x], graph.scratch_bytes_per_task);
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + tile_in8->dep + tile_in9->dep + 1;
   printf("Task10 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f, in8 %f, in9 %f\n", 
@@ -364,29 +392,25 @@ OpenMPApp::OpenMPApp(int argc, char **argv)
     matrix[i].M = graph.nb_fields;
     matrix[i].N = graph.max_width;
     matrix[i].data = (tile_t*)malloc(sizeof(tile_t) * matrix[i].M * matrix[i].N);
+    matrix[i].point_token = (char *)malloc(sizeof(char) * matrix[i].N);
   
     for (int j = 0; j < matrix[i].M * matrix[i].N; j++) {
       matrix[i].data[j].output_buff = (char *)malloc(sizeof(char) * graph.output_bytes_per_task);
     }
     
-    extra_local_memory[i] = (char**)malloc(sizeof(char*) * graph.max_width);
-    assert(extra_local_memory[i] != NULL);
-    for (int k = 0; k < graph.max_width; k++) {
-      if (graph.scratch_bytes_per_task > 0) {
-        extra_local_memory[i][k] = (char*)malloc(sizeof(char)*graph.scratch_bytes_per_task);
-      } else {
-        extra_local_memory[i][k] = NULL;
-      }
-    }
-    
     printf("graph id %d, M = %d, N = %d, data %p, nb_fields %d\n", i, matrix[i].M, matrix[i].N, matrix[i].data, graph.nb_fields);
   }
   
-  
+  scratch = new ScratchManager(*this, nb_workers, SCRATCH_PER_POINT);
 
   
  // omp_set_dynamic(1);
   omp_set_num_threads(nb_workers);
+
+  #pragma omp parallel
+  {
+    scratch->prepare_worker(omp_get_thread_num());
+  }
   
 
 }
@@ -400,18 +424,13 @@ OpenMPApp::~OpenMPApp()
     }
     free(matrix[i].data);
     matrix[i].data = NULL;
-    
-    TaskGraph &graph = graphs[i];
-    for (int j = 0; j < graph.max_width; j++) {
-      if (extra_local_memory[i][j] != NULL) {
-        free(extra_local_memory[i][j]);
-        extra_local_memory[i][j] = NULL;
-      }
-    }
-    free(extra_local_memory[i]);
-    extra_local_memory[i] = NULL;
+    free(matrix[i].point_token);
+    matrix[i].point_token = NULL;
   }
   
+  delete scratch;
+  scratch = NULL;
+  
   free(matrix);
   matrix = NULL;
   
@@ -420,6 +439,7 @@ OpenMPApp::~OpenMPApp()
 void OpenMPApp::execute_main_loop()
 { 
   display();
+  std::vector<std::pair<long, long> > order = submission_order();
   
   Timer::time_start();
   
@@ -427,12 +447,8 @@ void OpenMPApp::execute_main_loop()
   {
     #pragma omp master
     {
-      for (unsigned i = 0; i < graphs.size(); i++) {
-        const TaskGraph &g = graphs[i];
-        for (int y = 0; y < g.timesteps; y++) {
-          execute_timestep(i, y);
-        }
-        
+      for (auto &step : order) {
+        execute_timestep(step.first, step.second);
       }
 //      #pragma omp taskwait
     }
@@ -441,6 +457,7 @@ void OpenMPApp::execute_main_loop()
   
   double elapsed = Timer::time_end();
   report_timing(elapsed);
+  scratch->report_locality(elapsed);
 }
 
 void OpenMPApp::execute_timestep(size_t idx, long t)
@@ -502,7 +519,6 @@ void OpenMPApp::execute_timestep(size_t idx, long t)
     payload.graph_id = idx;
     payload.y = t;
     payload.x = x;
-    payload.graph = g;
     insert_task(args, num_args, payload);
   }
 }
@@ -517,7 +533,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
   switch(num_args) {
   case 1:
   {
-    #pragma omp task depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task1(&mat[y0 * matrix[graph_id].N + x0], payload);
     break;
   }
@@ -526,7 +542,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
   {
     int x1 = args[1].x;
     int y1 = args[1].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task2(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], payload);
     break;
@@ -538,7 +554,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
     int y1 = args[1].y;
     int x2 = args[2].x;
     int y2 = args[2].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task3(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], payload);
@@ -553,7 +569,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
     int y2 = args[2].y;
     int x3 = args[3].x;
     int y3 = args[3].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task4(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -571,7 +587,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
     int y3 = args[3].y;
     int x4 = args[4].x;
     int y4 = args[4].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task5(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -592,7 +608,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
     int y4 = args[4].y;
     int x5 = args[5].x;
     int y5 = args[5].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task6(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -616,7 +632,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
     int y5 = args[5].y;
     int x6 = args[6].x;
     int y6 = args[6].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task7(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -643,7 +659,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
     int y6 = args[6].y;
     int x7 = args[7].x;
     int y7 = args[7].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task8(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -673,7 +689,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
     int y7 = args[7].y;
     int x8 = args[8].x;
     int y8 = args[8].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task9(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -706,7 +722,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload)
     int y8 = args[8].y;
     int x9 = args[9].x;
     int y9 = args[9].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(in: mat[y9 * matrix[graph_id].N + x9]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(in: mat[y9 * matrix[graph_id].N + x9]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task10(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -36,7 +36,7 @@ typedef struct tile_s {
 typedef struct payload_s {
   int x;
   int y;
-  TaskGraph graph;
+  int graph_id;
 }payload_t;
 
 typedef struct task_args_s {
@@ -48,19 +48,25 @@ typedef struct matrix_s {
   tile_t *data;
   int M;
   int N;
+  char *point_token; // one byte per point, see point_order_token
 }matrix_t;
 
-#define NB_LOCAL_MEMORY 8
 
-char **extra_local_memory;
-int *extra_local_memory_idx;
-int memory_block_size = -1;
+ScratchManager *scratch = NULL;
+
+// Dependence object ordering a task after the previous task of its point.
+// Under SCRATCH_PER_POINT those tasks share one scratch block; otherwise the
+// tile's own output buffer is returned, which orders nothing new.
+static inline char *point_order_token(matrix_t &m, tile_t *tile, int x)
+{
+  return scratch->policy() == SCRATCH_PER_POINT ? &m.point_token[x] : tile->output_buff;
+}
 
 static inline void task1(tile_t *tile_out, payload_t payload)
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -68,10 +74,10 @@ static inline void task1(tile_t *tile_out, payload_t payload)
   input_ptrs.push_back((char*)tile_out->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
   
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else  
   tile_out->dep = 0;
   printf("Task1 tid %d, x %d, y %d, out %f\n", tid, payload.x, payload.y, tile_out->dep);
@@ -82,7 +88,7 @@ static inline void task2(tile_t *tile_out, tile_t *tile_in1, payload_t payload)
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -90,10 +96,10 @@ static inline void task2(tile_t *tile_out, tile_t *tile_in1, payload_t payload)
   input_ptrs.push_back((char*)tile_in1->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
   
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else  
   tile_out->dep = tile_in1->dep + 1;
   printf("Task2 tid %d, x %d, y %d, out %f, in1 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep);
@@ -104,7 +110,7 @@ static inline void task3(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, p
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -114,10 +120,10 @@ static inline void task3(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, p
   input_ptrs.push_back((char*)tile_in2->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                     input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                     input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else  
   tile_out->dep = tile_in1->dep + tile_in2->dep + 1;
   printf("Task3 tid %d, x %d, y %d, out %f, in1 %f, in2 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep);
@@ -128,7 +134,7 @@ static inline void task4(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -140,10 +146,10 @@ static inline void task4(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in3->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + 1;
   printf("Task4 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep);
@@ -154,7 +160,7 @@ static inline void task5(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -168,10 +174,10 @@ static inline void task5(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in4->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + 1;
   printf("Task5 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep);
@@ -182,7 +188,7 @@ static inline void task6(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -198,10 +204,10 @@ static inline void task6(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in5->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + 1;
   printf("Task6 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f\n", tid, payload.x, payload.y, tile_out->dep,tile_in1->dep, tile_in2->dep, tile_in3->dep, tile_in4->dep, tile_in5->dep);
@@ -212,7 +218,7 @@ static inline void task7(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -230,10 +236,10 @@ static inline void task7(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in6->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + 1;
   printf("Task7 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f\n", 
@@ -245,7 +251,7 @@ static inline void task8(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -265,10 +271,10 @@ static inline void task8(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in7->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + 1;
   printf("Task8 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f\n", 
@@ -280,7 +286,7 @@ static inline void task9(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -302,10 +308,10 @@ static inline void task9(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2, t
   input_ptrs.push_back((char*)tile_in8->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + tile_in8->dep + 1;
   printf("Task9 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f, in8 %f\n", 
@@ -317,7 +323,7 @@ static inline void task10(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2,
 {
   int tid = omp_get_thread_num();
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)tile_out->output_buff;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -341,10 +347,10 @@ static inline void task10(tile_t *tile_out, tile_t *tile_in1, tile_t *tile_in2,
   input_ptrs.push_back((char*)tile_in9->output_buff);
   input_bytes.push_back(graph.output_bytes_per_task);
 
+  char *scratch_ptr = scratch->acquire(tid, payload.graph_id, payload.y, payload.x);
   graph.execute_point(payload.y, payload.x, output_ptr, output_bytes,
-                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), extra_local_memory[tid]+extra_local_memory_idx[tid]*memory_block_size, graph.scratch_bytes_per_task);
-  extra_local_memory_idx[tid]++;
-  extra_local_memory_idx[tid] = extra_local_memory_idx[tid] % NB_LOCAL_MEMORY;
+                      input_ptrs.data(), input_bytes.data(), input_ptrs.size(), scratch_ptr, graph.scratch_bytes_per_task);
+  scratch->release(scratch_ptr);
 #else
   tile_out->dep = tile_in1->dep + tile_in2->dep + tile_in3->dep + tile_in4->dep + tile_in5->dep + tile_in6->dep + tile_in7->dep + tile_in8->dep + tile_in9->dep + 1;
   printf("Task10 tid %d, x %d, y %d, out %f, in1 %f, in2 %f, in3 %f, in4 %f, in5 %f, in6 %f, in7 %f, in8 %f, in9 %f\n", 
@@ -380,54 +386,31 @@ OpenMPApp::OpenMPApp(int argc, char **argv)
   
   matrix = (matrix_t *)malloc(sizeof(matrix_t) * graphs.size());
   
-  size_t max_scratch_bytes_per_task = 0;
-  
   for (unsigned i = 0; i < graphs.size(); i++) {
     TaskGraph &graph = graphs[i];
     
     matrix[i].M = graph.nb_fields;
     matrix[i].N = graph.max_width;
     matrix[i].data = (tile_t*)malloc(sizeof(tile_t) * matrix[i].M * matrix[i].N);
+    matrix[i].point_token = (char *)malloc(sizeof(char) * matrix[i].N);
   
     for (int j = 0; j < matrix[i].M * matrix[i].N; j++) {
       matrix[i].data[j].output_buff = (char *)malloc(sizeof(char) * graph.output_bytes_per_task);
     }
     
-    if (graph.scratch_bytes_per_task > max_scratch_bytes_per_task) {
-      max_scratch_bytes_per_task = graph.scratch_bytes_per_task;
-    }
-    
     printf("graph id %d, M = %d, N = %d, data %p, nb_fields %d\n", i, matrix[i].M, matrix[i].N, matrix[i].data, graph.nb_fields);
   }
   
-  extra_local_memory = (char**)malloc(sizeof(char*) * nb_workers);
-  assert(extra_local_memory != NULL);
-  extra_local_memory_idx = (int*)malloc(sizeof(int) * nb_workers);
-  assert(extra_local_memory_idx != NULL);
-  for (int k = 0; k < nb_workers; k++) {
-    if (max_scratch_bytes_per_task > 0) {
-      extra_local_memory[k] = (char*)malloc(sizeof(char) * max_scratch_bytes_per_task * NB_LOCAL_MEMORY);
-    } else {
-      extra_local_memory[k] = NULL;
-    }
-    extra_local_memory_idx[k] = 0;
-  }
-  
-  memory_block_size = max_scratch_bytes_per_task;
+  // Each worker cycles through a ring of blocks (App::scratch_ring, 8 by default).
+  scratch = new ScratchManager(*this, nb_workers, SCRATCH_WORKER_RING);
   
  // omp_set_dynamic(1);
   omp_set_num_threads(nb_workers);
 
-  if (max_scratch_bytes_per_task > 0) {
-    #pragma omp parallel
-    {
-      int tid = omp_get_thread_num();
-      //printf("im tid %d\n", tid);
-      for (int k = 0; k < NB_LOCAL_MEMORY; k++) {
-        TaskGraph::prepare_scratch(extra_local_memory[tid] + k * max_scratch_bytes_per_task, sizeof(char)*max_scratch_bytes_per_task);
-      }
-    }
-  }  
+  #pragma omp parallel
+  {
+    scratch->prepare_worker(omp_get_thread_num());
+  }
 
 }
 
@@ -440,26 +423,21 @@ OpenMPApp::~OpenMPApp()
     }
     free(matrix[i].data);
     matrix[i].data = NULL;
+    free(matrix[i].point_token);
+    matrix[i].point_token = NULL;
   }
   
   free(matrix);
   matrix = NULL;
   
-  for (int j = 0; j < nb_workers; j++) {
-    if (extra_local_memory[j] != NULL) {
-      free(extra_local_memory[j]);
-      extra_local_memory[j] = NULL;
-    }
-  }
-  free(extra_local_memory);
-  extra_local_memory = NULL;
-  free(extra_local_memory_idx);
-  extra_local_memory_idx = NULL;
+  delete scratch;
+  scratch = NULL;
 }
 
 void OpenMPApp::execute_main_loop()
 { 
   display();
+  std::vector<std::pair<long, long> > order = submission_order();
   
   Timer::time_start();
   
@@ -467,12 +445,8 @@ void OpenMPApp::execute_main_loop()
   {
     #pragma omp master
     {
-      for (unsigned i = 0; i < graphs.size(); i++) {
-        const TaskGraph &g = graphs[i];
-        for (int y = 0; y < g.timesteps; y++) {
-          execute_timestep(i, y);
-        }
-        
+      for (auto &step : order) {
+        execute_timestep(step.first, step.second);
       }
 //      #pragma omp taskwait
     }
@@ -481,6 +455,7 @@ void OpenMPApp::execute_main_loop()
   
   double elapsed = Timer::time_end();
   report_timing(elapsed);
+  scratch->report_locality(elapsed);
 }
 
 void OpenMPApp::execute_timestep(size_t idx, long t)
@@ -541,7 +516,7 @@ void OpenMPApp::execute_timestep(size_t idx, long t)
     
     payload.y = t;
     payload.x = x;
-    payload.graph = g;
+    payload.graph_id = g.graph_index;
     insert_task(args, num_args, payload, idx);
   }
 }
@@ -555,7 +530,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
   switch(num_args) {
   case 1:
   {
-    #pragma omp task depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task1(&mat[y0 * matrix[graph_id].N + x0], payload);
     break;
   }
@@ -564,7 +539,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
   {
     int x1 = args[1].x;
     int y1 = args[1].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task2(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], payload);
     break;
@@ -576,7 +551,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
     int y1 = args[1].y;
     int x2 = args[2].x;
     int y2 = args[2].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task3(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], payload);
@@ -591,7 +566,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
     int y2 = args[2].y;
     int x3 = args[3].x;
     int y3 = args[3].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task4(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -609,7 +584,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
     int y3 = args[3].y;
     int x4 = args[4].x;
     int y4 = args[4].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task5(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -630,7 +605,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
     int y4 = args[4].y;
     int x5 = args[5].x;
     int y5 = args[5].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task6(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -654,7 +629,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
     int y5 = args[5].y;
     int x6 = args[6].x;
     int y6 = args[6].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task7(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -681,7 +656,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
     int y6 = args[6].y;
     int x7 = args[7].x;
     int y7 = args[7].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task8(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -711,7 +686,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
     int y7 = args[7].y;
     int x8 = args[8].x;
     int y8 = args[8].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task9(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -744,7 +719,7 @@ void OpenMPApp::insert_task(task_args_t *args, int num_args, payload_t payload,
     int y8 = args[8].y;
     int x9 = args[9].x;
     int y9 = args[9].y;
-    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(in: mat[y9 * matrix[graph_id].N + x9]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) untied mergeable
+    #pragma omp task depend(in: mat[y1 * matrix[graph_id].N + x1]) depend(in: mat[y2 * matrix[graph_id].N + x2]) depend(in: mat[y3 * matrix[graph_id].N + x3]) depend(in: mat[y4 * matrix[graph_id].N + x4]) depend(in: mat[y5 * matrix[graph_id].N + x5]) depend(in: mat[y6 * matrix[graph_id].N + x6]) depend(in: mat[y7 * matrix[graph_id].N + x7]) depend(in: mat[y8 * matrix[graph_id].N + x8]) depend(in: mat[y9 * matrix[graph_id].N + x9]) depend(inout: mat[y0 * matrix[graph_id].N + x0]) depend(inout: *point_order_token(matrix[graph_id], &mat[y0 * matrix[graph_id].N + x0], x0)) untied mergeable
       task10(&mat[y0 * matrix[graph_id].N + x0], 
             &mat[y1 * matrix[graph_id].N + x1], 
             &mat[y2 * matrix[graph_id].N + x2], 
@@ -55,7 +55,6 @@ typedef struct payload_s {
   int graph_id;
   int i;
   int j;
-  TaskGraph graph;
 }payload_t;
 
 static inline int
@@ -77,7 +76,7 @@ static int test_task1(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &out);
 
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -111,7 +110,7 @@ static int test_task2(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &out);
 
 #if defined (USE_CORE_VERIFICATION)      
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -143,7 +142,7 @@ static int test_task3(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &out);
 
 #if defined (USE_CORE_VERIFICATION)      
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -178,7 +177,7 @@ static int test_task4(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -214,7 +213,7 @@ static int test_task5(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -252,7 +251,7 @@ static int test_task6(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -292,7 +291,7 @@ static int test_task7(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &in6, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -334,7 +333,7 @@ static int test_task8(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &in6, &in7, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -378,7 +377,7 @@ static int test_task9(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &in6, &in7, &in8, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -424,7 +423,7 @@ static int test_task10(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &in6, &in7, &in8, &in9, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -678,7 +677,7 @@ ParsecApp::ParsecApp(int argc, char **argv)
     if (nb_fields_arg > 0) {
       nb_fields = nb_fields_arg;
     } else {
-      nb_fields = graph.timesteps;
+      nb_fields = graph.nb_fields;
     }
     
     MB_cal = sqrt(graph.output_bytes_per_task / sizeof(float));
@@ -924,7 +923,6 @@ void ParsecApp::execute_timestep(size_t idx, long t)
 
     payload.i = t;
     payload.j = x;
-    payload.graph = g;
     payload.graph_id = idx;
     insert_task(num_args, payload, args); 
     args.clear();
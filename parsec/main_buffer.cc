@@ -60,7 +60,6 @@ typedef struct payload_s {
   int graph_id;
   int i;
   int j;
-  TaskGraph graph;
 }payload_t;
 
 static inline int
@@ -82,7 +81,7 @@ static int test_task1(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &out);
 
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -126,7 +125,7 @@ static int test_task2(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &out);
 
 #if defined (USE_CORE_VERIFICATION)      
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -168,7 +167,7 @@ static int test_task3(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &out);
 
 #if defined (USE_CORE_VERIFICATION)      
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -212,7 +211,7 @@ static int test_task4(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -258,7 +257,7 @@ static int test_task5(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -306,7 +305,7 @@ static int test_task6(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -356,7 +355,7 @@ static int test_task7(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &in6, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -408,7 +407,7 @@ static int test_task8(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &in6, &in7, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -462,7 +461,7 @@ static int test_task9(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &in6, &in7, &in8, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -518,7 +517,7 @@ static int test_task10(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &in6, &in7, &in8, &in9, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -782,7 +781,7 @@ ParsecApp::ParsecApp(int argc, char **argv)
     if (nb_fields_arg > 0) {
       nb_fields = nb_fields_arg;
     } else {
-      nb_fields = graph.timesteps;
+      nb_fields = graph.nb_fields;
     }
     
     MB_cal = sqrt(graph.output_bytes_per_task / sizeof(float));
@@ -1040,7 +1039,6 @@ void ParsecApp::execute_timestep(size_t idx, long t)
 
     payload.i = t;
     payload.j = x;
-    payload.graph = g;
     payload.graph_id = idx;
     insert_task(num_args, payload, args); 
     args.clear();
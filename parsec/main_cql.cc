@@ -55,7 +55,6 @@ typedef struct payload_s {
   int graph_id;
   int i;
   int j;
-  TaskGraph graph;
 }payload_t;
 
 static inline int
@@ -77,7 +76,7 @@ static int test_task1(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &out);
 
 #if defined (USE_CORE_VERIFICATION)    
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -111,7 +110,7 @@ static int test_task2(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &out);
 
 #if defined (USE_CORE_VERIFICATION)      
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -143,7 +142,7 @@ static int test_task3(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &out);
 
 #if defined (USE_CORE_VERIFICATION)      
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -178,7 +177,7 @@ static int test_task4(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -214,7 +213,7 @@ static int test_task5(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -252,7 +251,7 @@ static int test_task6(parsec_execution_stream_t *es, parsec_task_t *this_task)
   parsec_dtd_unpack_args(this_task, &payload, &in1, &in2, &in3, &in4, &in5, &out);
 
 #if defined (USE_CORE_VERIFICATION)  
-  TaskGraph graph = payload.graph;
+  const TaskGraph &graph = TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph.output_bytes_per_task;
   std::vector<const char *> input_ptrs;
@@ -444,7 +443,7 @@ ParsecApp::ParsecApp(int argc, char **argv)
     if (nb_fields_arg > 0) {
       nb_fields = nb_fields_arg;
     } else {
-      nb_fields = graph.timesteps;
+      nb_fields = graph.nb_fields;
     }
     
     MB_cal = sqrt(graph.output_bytes_per_task / sizeof(float));
@@ -688,7 +687,6 @@ void ParsecApp::execute_timestep(size_t idx, long t, int8_t *is_inserted)
 
                 payload_pre.i = t-1;
                 payload_pre.j = i;
-                payload_pre.graph = g;
                 payload_pre.graph_id = idx;
                 ((parsec_dtd_taskpool_t *)dtd_tp)->task_id = mat.NT * (t-1) + i + 1;
                 insert_task(num_args_pre, payload_pre, args_pre);
@@ -705,7 +703,6 @@ void ParsecApp::execute_timestep(size_t idx, long t, int8_t *is_inserted)
     /* Insert local task */
     payload.i = t;
     payload.j = x;
-    payload.graph = g;
     payload.graph_id = idx;
     ((parsec_dtd_taskpool_t *)dtd_tp)->task_id = mat.NT * t + x + 1;
     debug_printf(1, "Self: rank: %d, x: %d, t: %d, task_id: %d\n", rank , x, t, mat.NT * t + x + 1);
@@ -751,7 +748,6 @@ void ParsecApp::execute_timestep(size_t idx, long t, int8_t *is_inserted)
 
                     payload_next.i = t+1;
                     payload_next.j = i;
-                    payload_next.graph = g;
                     payload_next.graph_id = idx;
                     ((parsec_dtd_taskpool_t *)dtd_tp)->task_id = mat.NT * (t+1) + i + 1;
                     insert_task(num_args_next, payload_next, args_next);
@@ -138,7 +138,7 @@ ParsecApp::ParsecApp(int argc, char **argv)
     if (nb_fields_arg > 0) {
       nb_fields = nb_fields_arg;
     } else {
-      nb_fields = graph.timesteps;
+      nb_fields = graph.nb_fields;
     }
     
     MB_cal = sqrt(graph.output_bytes_per_task / sizeof(float));
@@ -24,11 +24,19 @@ class SERtask_graph_t implements Serializable {
     private int iterations;
     private int samples;
     private double imbalance;
+    private int imbalance_distribution;
+    private double imbalance_param;
+    private int imbalance_corr_width;
+    private int imbalance_corr_steps;
     private int radix;
     private int period;
     private double fraction_connected;
     private long output_bytes_per_task;
+    private long min_output_bytes_per_task;
+    private int output_distribution;
     private long scratch_bytes_per_task; 
+    private int validation;
+    private int validation_samples;
 
     public SERtask_graph_t(task_graph_t taskGraph) { 
         this.graph_index = taskGraph.getGraph_index();
@@ -39,11 +47,19 @@ class SERtask_graph_t implements Serializable {
         this.iterations = taskGraph.getKernel().getIterations();
         this.samples = taskGraph.getKernel().getSamples();
         this.imbalance = taskGraph.getKernel().getImbalance();
+        this.imbalance_distribution = taskGraph.getKernel().getImbalance_distribution().swigValue();
+        this.imbalance_param = taskGraph.getKernel().getImbalance_param();
+        this.imbalance_corr_width = taskGraph.getKernel().getImbalance_corr_width();
+        this.imbalance_corr_steps = taskGraph.getKernel().getImbalance_corr_steps();
         this.radix = taskGraph.getRadix();
         this.period = taskGraph.getPeriod();
         this.fraction_connected = taskGraph.getFraction_connected();
         this.output_bytes_per_task = taskGraph.getOutput_bytes_per_task();
+        this.min_output_bytes_per_task = taskGraph.getMin_output_bytes_per_task();
+        this.output_distribution = taskGraph.getOutput_distribution().swigValue();
         this.scratch_bytes_per_task = taskGraph.getScratch_bytes_per_task();
+        this.validation = taskGraph.getValidation().swigValue();
+        this.validation_samples = taskGraph.getValidation_samples();
     }
 
     public task_graph_t toTaskGraph( ) {
@@ -57,12 +73,20 @@ class SERtask_graph_t implements Serializable {
         k.setIterations(this.iterations);
         k.setSamples(this.samples);
         k.setImbalance(this.imbalance);
+        k.setImbalance_distribution(imbalance_distribution_t.swigToEnum(this.imbalance_distribution));
+        k.setImbalance_param(this.imbalance_param);
+        k.setImbalance_corr_width(this.imbalance_corr_width);
+        k.setImbalance_corr_steps(this.imbalance_corr_steps);
         tg.setKernel(k); 
         tg.setRadix(this.radix);
         tg.setPeriod(this.period);
         tg.setFraction_connected(this.fraction_connected);
         tg.setOutput_bytes_per_task(this.output_bytes_per_task);
+        tg.setMin_output_bytes_per_task(this.min_output_bytes_per_task);
+        tg.setOutput_distribution(output_distribution_t.swigToEnum(this.output_distribution));
         tg.setScratch_bytes_per_task(this.scratch_bytes_per_task);
+        tg.setValidation(validation_level_t.swigToEnum(this.validation));
+        tg.setValidation_samples(this.validation_samples);
         return tg;
     }
 
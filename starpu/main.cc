@@ -43,7 +43,6 @@ typedef struct payload_s {
   int graph_id;
   int i;
   int j;
-  const TaskGraph *graph;
 }payload_t;
 
 static void init_extra_local_memory(void *arg)
@@ -66,7 +65,7 @@ static void task1(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
   
 #if defined (USE_CORE_VERIFICATION) 
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -98,7 +97,7 @@ static void task2(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
   
 #if defined (USE_CORE_VERIFICATION)   
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -131,7 +130,7 @@ static void task3(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -167,7 +166,7 @@ static void task4(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -207,7 +206,7 @@ static void task5(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -250,7 +249,7 @@ static void task6(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -296,7 +295,7 @@ static void task7(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -346,7 +345,7 @@ static void task8(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -400,7 +399,7 @@ static void task9(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -456,7 +455,7 @@ static void task10(void *descr[], void *cl_arg, int starpu_cuda)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -694,6 +693,7 @@ private:
   char *starpu_schedule;
   char *custom_dag_file = nullptr;
   char *task_type_runtime_file = nullptr;
+  char *task_type_output_file = nullptr;
   char *priority_file = nullptr;
   char *efficiency_file = nullptr;
   char *ability_file = nullptr;
@@ -719,15 +719,15 @@ void StarPUApp::insert_task_custom(int num_args, payload_t &payload, std::array<
   starpu_ddesc_t *descA = mat_array[payload.graph_id].ddescA;
   int t = payload.i;
   int p = payload.j;
-  CustomTaskInfo *task_info = payload.graph->get_task_info();
+  CustomTaskInfo *task_info = TaskGraph::from_handle(payload.graph_id).get_task_info();
   std::string task_name;
   if (task_info != nullptr) {
-    task_name = payload.graph->getTaskTypeAtPoint(t, p);
+    task_name = TaskGraph::from_handle(payload.graph_id).getTaskTypeAtPoint(t, p);
   } else {
     task_name = "task_" + std::to_string(num_args);
   }
   starpu_codelet* cl_task;
-  if (payload.graph->dependence == DependenceType::USER_DEFINED) {
+  if (TaskGraph::from_handle(payload.graph_id).dependence == DependenceType::USER_DEFINED) {
     cl_task = &task_name_to_codelet[task_name];
   } else {
     assert (false && "Not implemented");
@@ -887,15 +887,15 @@ void StarPUApp::insert_task(int num_args, payload_t &payload, std::array<starpu_
   starpu_ddesc_t *descA = mat_array[payload.graph_id].ddescA;
   int t = payload.i;
   int p = payload.j;
-  CustomTaskInfo *task_info = payload.graph->get_task_info();
+  CustomTaskInfo *task_info = TaskGraph::from_handle(payload.graph_id).get_task_info();
   std::string task_name;
   if (task_info != nullptr) {
-    task_name = payload.graph->getTaskTypeAtPoint(t, p);
+    task_name = TaskGraph::from_handle(payload.graph_id).getTaskTypeAtPoint(t, p);
   } else {
     task_name = "task_" + std::to_string(num_args);
   }
   starpu_codelet* cl_task;
-  if (payload.graph->dependence == DependenceType::USER_DEFINED) {
+  if (TaskGraph::from_handle(payload.graph_id).dependence == DependenceType::USER_DEFINED) {
     cl_task = &task_name_to_codelet[task_name];
   } else {
     assert (false && "Not implemented");
@@ -1072,6 +1072,9 @@ void StarPUApp::parse_argument(int argc, char **argv)
     if (!strcmp(argv[i], "-task_type_runtime")) {
       task_type_runtime_file = argv[++i];
     }
+    if (!strcmp(argv[i], "-task_type_output")) {
+      task_type_output_file = argv[++i];
+    }
     if (!strcmp(argv[i], "-priority")) {
       priority_file = argv[++i];
     }
@@ -1269,6 +1272,9 @@ StarPUApp::StarPUApp(int argc, char **argv)
       } else {
         custom_task_info = new CustomTaskInfo(custom_dag_file);
       }
+      if (task_type_output_file != nullptr) {
+        custom_task_info->setTaskOutputBytes(task_type_output_file);
+      }
       graph.set_task_info(custom_task_info);
     }
   } else {
@@ -1278,6 +1284,14 @@ StarPUApp::StarPUApp(int argc, char **argv)
     }
   }
 
+  // Outputs of CUDA tasks are never filled on the host, so a consumer
+  // on a CPU worker would see stale data.
+  if (n_gpu > 0) {
+    for (int i = 0; i < graphs.size(); i++) {
+      graphs[i].validation = ValidationLevel::VALIDATE_NONE;
+    }
+  }
+
   for (int i = 0; i < graphs.size(); i++) {
     TaskGraph &graph = graphs[i];
     // if dependency is not user_defined, init task_cl using init_task_default
@@ -1414,18 +1428,17 @@ void StarPUApp::execute_main_loop()
         starpu_desc_getaddr( mat.ddescA, y%nb_fields, x );
     }
   }
+
+  std::vector<std::pair<long, long> > order = submission_order();
+
   /* start timer */
   starpu_mpi_barrier(MPI_COMM_WORLD);
   if (rank == 0) {
     Timer::time_start();
   }
   
-  for (int i = 0; i < graphs.size(); i++) {
-    const TaskGraph &g = graphs[i];
-
-    for (y = 0; y < g.timesteps; y++) {
-      execute_timestep(i, y);
-    }
+  for (auto &step : order) {
+    execute_timestep(step.first, step.second);
   }
 
   starpu_task_wait_for_all();
@@ -1540,7 +1553,6 @@ void StarPUApp::execute_timestep(size_t idx, long t)
     
     payload.i = t;
     payload.j = x;
-    payload.graph = &g;
     payload.graph_id = idx;
     if (strcmp(starpu_schedule, "dmdap") == 0) {
       int priority = 0;
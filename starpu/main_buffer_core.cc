@@ -44,7 +44,6 @@ typedef struct payload_s {
   int graph_id;
   int i;
   int j;
-  const TaskGraph *graph;
 }payload_t;
 
 static void task1(void *descr[], void *cl_arg)
@@ -57,7 +56,7 @@ static void task1(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION) 
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -98,7 +97,7 @@ static void task2(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
   
 #if defined (USE_CORE_VERIFICATION)   
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -140,7 +139,7 @@ static void task3(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -185,7 +184,7 @@ static void task4(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -233,7 +232,7 @@ static void task5(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -284,7 +283,7 @@ static void task6(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -338,7 +337,7 @@ static void task7(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -396,7 +395,7 @@ static void task8(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -457,7 +456,7 @@ static void task9(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -521,7 +520,7 @@ static void task10(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload.graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload.graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -941,18 +940,16 @@ void StarPUApp::execute_main_loop()
     }
   }
 
+  std::vector<std::pair<long, long> > order = submission_order();
+
   /* start timer */
   starpu_mpi_barrier(MPI_COMM_WORLD);
   if (rank == 0) {
     Timer::time_start();
   }
   
-  for (int i = 0; i < graphs.size(); i++) {
-    const TaskGraph &g = graphs[i];
-
-    for (y = 0; y < g.timesteps; y++) {
-      execute_timestep(i, y);
-    }
+  for (auto &step : order) {
+    execute_timestep(step.first, step.second);
   }
 
   starpu_task_wait_for_all();
@@ -1032,7 +1029,6 @@ void StarPUApp::execute_timestep(size_t idx, long t)
     
     payload.i = t;
     payload.j = x;
-    payload.graph = &g;
     payload.graph_id = idx;
     insert_task(num_args, payload, args); 
   }
@@ -39,7 +39,6 @@ typedef struct payload_s {
   int graph_id;
   int i;
   int j;
-  const TaskGraph *graph;
 }payload_t;
 
 static void init_extra_local_memory(void *arg)
@@ -60,7 +59,7 @@ static void task1(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
   
 #if defined (USE_CORE_VERIFICATION) 
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -91,7 +90,7 @@ static void task2(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
   
 #if defined (USE_CORE_VERIFICATION)   
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -123,7 +122,7 @@ static void task3(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -158,7 +157,7 @@ static void task4(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -197,7 +196,7 @@ static void task5(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -239,7 +238,7 @@ static void task6(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -284,7 +283,7 @@ static void task7(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -333,7 +332,7 @@ static void task8(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -386,7 +385,7 @@ static void task9(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -441,7 +440,7 @@ static void task10(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -953,7 +952,6 @@ void StarPUApp::execute_main_loop()
 
         payload.i = t;
         payload.j = x;
-        payload.graph = &g;
         payload.graph_id = i;
         debug_printf(1, "%d submits task %d for t=%d\n", rank, x, t);
         insert_task(num_args, payload, data);
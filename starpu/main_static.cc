@@ -52,7 +52,6 @@ typedef struct payload_s {
   int j;
   int descrnum[10];
   char num_args;
-  const TaskGraph *graph;
   std::vector<std::pair<long, long>> *depslist;
   std::vector<std::pair<long, long>> *rdepslist;
   std::vector<std::pair<long, long>> *antidepslist;
@@ -77,7 +76,7 @@ static void task1(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
   
 #if defined (USE_CORE_VERIFICATION) 
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -108,7 +107,7 @@ static void task2(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
   
 #if defined (USE_CORE_VERIFICATION)   
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -140,7 +139,7 @@ static void task3(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -175,7 +174,7 @@ static void task4(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -214,7 +213,7 @@ static void task5(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -256,7 +255,7 @@ static void task6(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -301,7 +300,7 @@ static void task7(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -350,7 +349,7 @@ static void task8(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -403,7 +402,7 @@ static void task9(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -458,7 +457,7 @@ static void task10(void *descr[], void *cl_arg)
   int tid = starpu_worker_get_id();
 
 #if defined (USE_CORE_VERIFICATION)  
-  const TaskGraph *graph = payload->graph;
+  const TaskGraph *graph = &TaskGraph::from_handle(payload->graph_id);
   char *output_ptr = (char*)out;
   size_t output_bytes= graph->output_bytes_per_task;
   const char *input_data[] = {
@@ -560,7 +559,7 @@ static void _task_callback(void *arg)
 
 void StarPUApp::task_callback(struct starpu_task *task, payload_t *payload)
 {
-  const TaskGraph *g = payload->graph;
+  const TaskGraph *g = &TaskGraph::from_handle(payload->graph_id);
   int nb_fields = g->nb_fields;
   int id = payload->graph_id;
   matrix_t &mat = mat_array[id];
@@ -660,7 +659,7 @@ void StarPUApp::task_callback(struct starpu_task *task, payload_t *payload)
 
 void StarPUApp::update_task(struct starpu_task *task, payload_t *payload)
 {
-  const TaskGraph *g = payload->graph;
+  const TaskGraph *g = &TaskGraph::from_handle(payload->graph_id);
   int nb_fields = g->nb_fields;
   int id = payload->graph_id;
   matrix_t &mat = mat_array[id];
@@ -695,7 +694,7 @@ void StarPUApp::update_task(struct starpu_task *task, payload_t *payload)
 struct starpu_task *StarPUApp::create_task(payload_t &payload)
 {
   struct starpu_task *task = starpu_task_create();
-  const TaskGraph *g = payload.graph;
+  const TaskGraph *g = &TaskGraph::from_handle(payload.graph_id);
   int nb_fields = g->nb_fields;
   int t = payload.i;
   int x = payload.j;
@@ -772,7 +771,7 @@ static void _mpi_recv_callback(void *arg)
 void StarPUApp::mpi_recv_callback(struct starpu_task *task, payload_t *payload)
 {
   /* We can start receiving data */
-  const TaskGraph *g = payload->graph;
+  const TaskGraph *g = &TaskGraph::from_handle(payload->graph_id);
   int nb_fields = g->nb_fields;
   int id = payload->graph_id;
   matrix_t &mat = mat_array[id];
@@ -1001,7 +1000,6 @@ void StarPUApp::execute_main_loop()
     int constructed[period][g.max_width];
     int received[period][g.max_width];
     payload.graph_id = i;
-    payload.graph = &g;
     debug_printf(1, "%d new graph %ld %ldx%ld\n", rank, i, period, g.max_width);
 
     memset(&constructed, 0, sizeof(constructed));
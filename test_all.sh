@@ -47,7 +47,23 @@ if [[ $TASKBENCH_USE_MPI -eq 1 ]]; then
                 mpirun -np 2 ./mpi/$binary -steps $steps -type $t $k -nodes 2
                 mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -nodes 4
                 mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -and -steps $steps -type $t $k -nodes 4
+                mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -nodes 4 -persistent
+                mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -nodes 4 -aggregate
+                mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -nodes 4 -aggregate -persistent
+                mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -nodes 4 -zero-copy
+                mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -nodes 4 -zero-copy -aggregate -persistent
+                mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -nodes 4 -shared-memory
+                mpirun -np 4 ./mpi/$binary -steps $steps -type $t $k -nodes 4 -shared-memory -zero-copy -persistent
             done
+            for sync in fence pscw passive; do
+                mpirun -np 4 ./mpi/rma -steps $steps -type $t $k -nodes 4 -sync $sync
+                mpirun -np 4 ./mpi/rma -steps $steps -type $t $k -and -steps $steps -type $t $k -nodes 4 -sync $sync
+            done
+            mpirun -np 1 ./mpi/neighbor -steps $steps -type $t $k -nodes 1
+            mpirun -np 4 ./mpi/neighbor -steps $steps -type $t $k -nodes 4
+            mpirun -np 4 ./mpi/neighbor -steps $steps -type $t $k -and -steps $steps -type $t $k -nodes 4
+            mpirun -np 4 ./mpi/dataflow -steps $steps -type $t $k -nodes 4
+            mpirun -np 4 ./mpi/dataflow -steps $steps -type $t $k -and -steps $steps -type $t $k -nodes 4 -progress-thread
         done
     done
     for t in no_comm stencil_1d stencil_1d_periodic all_to_all; do # FIXME: trivial dom tree fft nearest spread random_nearest are broken
@@ -233,6 +249,33 @@ if [[ $USE_OPENMP -eq 1 ]]; then
         for k in "${kernels[@]}"; do
             ./openmp/main -steps $steps -type $t $k -worker 2
             ./openmp/main -steps $steps -type $t $k -and -steps $steps -type $t $k -worker 2
+            ./openmp/main -steps $steps -type $t $k -and -steps $steps -type $t $k -worker 2 -submit round-robin
+            ./openmp/main -steps $steps -type $t $k -and -steps $steps -width 2 -type $t $k -worker 2 -submit weighted
+            ./openmp/main -steps $steps -type $t $k -worker 2 -scratch-policy task
+            ./openmp/main -steps $steps -type $t $k -worker 2 -point-resident
+            ./openmp/forall -steps $steps -type $t $k -worker 2
+            ./openmp/forall -steps $steps -type $t $k -worker 2 -schedule dynamic -chunk 1
+            ./openmp/forall -steps $steps -type $t $k -and -steps $steps -type $t $k -worker 2 -schedule taskloop
+        done
+    done
+fi
+
+if [[ $USE_NATIVE -eq 1 ]]; then
+    for t in "${basic_types[@]}"; do
+        for k in "${kernels[@]}"; do
+            ./native/main -steps $steps -type $t $k -worker 2
+            ./native/main -steps $steps -type $t $k -and -steps $steps -type $t $k -worker 2
+            ./native/main -steps $steps -type $t $k -worker 2 -field 2
+            ./native/main -steps $steps -type $t $k -worker 2 -point-resident
+            ./native/wavefront -steps $steps -type $t $k -worker 2
+            ./native/wavefront -steps $steps -type $t $k -and -steps $steps -type $t $k -worker 2 -barrier tree
+            ./native/wavefront -steps $steps -type $t $k -worker 2 -barrier flags
+            ./native/wavefront -steps $steps -type $t $k -worker 2 -partition dynamic
+            ./native/coroutine -steps $steps -type $t $k -worker 2
+            ./native/coroutine -steps $steps -type $t $k -and -steps $steps -type $t $k -worker 2 -frame-alloc malloc
+            ./native/replay -steps $steps -type $t $k -worker 2
+            ./native/replay -steps $steps -type $t $k -and -steps $steps -type $t $k -worker 2 -window 3
+            ./native/replay -steps $steps -type $t $k -worker 2 -window 3 -point-resident
         done
     done
 fi